@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "io.h"
+#include "terminal.h"
+#include "keyboard.h"
+#include "gdt.h"
+
+// Host-side microbenchmarks for the terminal, keyboard and GDT code. The
+// kernel sources are compiled unmodified against bench/host/io.h, so besides
+// wall time every run also reports the exact port I/O and MMIO traffic.
+
+struct benchmark {
+    const char* name;
+    uint32_t iterations;
+    void (*setup)(void);
+    void (*op)(uint32_t i);
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void setup_terminal(void) {
+    terminal_initialize();
+}
+
+static void op_putchar(uint32_t i) {
+    terminal_putchar('a' + i % 26);
+}
+
+static void op_writestring_line(uint32_t i) {
+    (void)i;
+    terminal_writestring("> gdt\nUnknown command. Available commands:\n");
+}
+
+static void op_scroll(uint32_t i) {
+    (void)i;
+    terminal_scroll();
+}
+
+static void op_clear(uint32_t i) {
+    (void)i;
+    terminal_clear();
+}
+
+static void op_switch_screen(uint32_t i) {
+    terminal_switch_screen(i & 1);
+}
+
+static void op_writehex(uint32_t i) {
+    terminal_writehex(i * 0x9E3779B9u);
+}
+
+static volatile char ascii_sink;
+
+static void op_scancode_to_ascii(uint32_t i) {
+    ascii_sink = keyboard_scancode_to_ascii(i % 0x60);
+}
+
+// One keyboard IRQ drain step plus the translation done in deferred work
+static void op_keyboard_poll(uint32_t i) {
+    (void)i;
+    if (keyboard_is_key_pressed()) {
+        uint8_t scancode = keyboard_get_scancode();
+        if (!keyboard_is_released(scancode)) {
+            ascii_sink = keyboard_scancode_to_ascii(scancode);
+        }
+    }
+}
+
+static void op_gdt_set_gate(uint32_t i) {
+    gdt_set_gate(1 + i % 5, 0, 0xFFFFFFFF,
+        GDT_ACCESS_PRESENT | GDT_ACCESS_RING0 | GDT_ACCESS_CODE | GDT_ACCESS_EXECUTE,
+        GDT_GRAN_4K | GDT_GRAN_32BIT);
+}
+
+static const struct benchmark benchmarks[] = {
+    { "terminal_putchar",           200000, setup_terminal, op_putchar },
+    { "terminal_writestring(line)",  20000, setup_terminal, op_writestring_line },
+    { "terminal_writehex",           50000, setup_terminal, op_writehex },
+    { "terminal_scroll",             20000, setup_terminal, op_scroll },
+    { "terminal_clear",              20000, setup_terminal, op_clear },
+    { "terminal_switch_screen",      20000, setup_terminal, op_switch_screen },
+    { "keyboard_scancode_to_ascii", 5000000, NULL,          op_scancode_to_ascii },
+    { "keyboard poll+translate",    2000000, NULL,          op_keyboard_poll },
+    { "gdt_set_gate",               100000, NULL,           op_gdt_set_gate },
+};
+
+static void run(const struct benchmark* b) {
+    // Warm caches and branch predictors, then reset state for the timed run
+    if (b->setup) {
+        b->setup();
+    }
+    for (uint32_t i = 0; i < b->iterations / 10; i++) {
+        b->op(i);
+    }
+    if (b->setup) {
+        b->setup();
+    }
+
+    struct host_io_stats before = host_io;
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < b->iterations; i++) {
+        b->op(i);
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    double n = (double)b->iterations;
+    printf("%-28s %10.1f %12.2f %12.2f %12.2f\n", b->name,
+        (double)elapsed / n,
+        (double)(host_io.port_writes - before.port_writes) / n,
+        (double)(host_io.port_reads - before.port_reads) / n,
+        (double)(host_io.mmio_writes - before.mmio_writes) / n);
+}
+
+int main(void) {
+    printf("%-28s %10s %12s %12s %12s\n", "benchmark", "ns/op", "port wr/op", "port rd/op", "mmio wr/op");
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        run(&benchmarks[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef CPU_H
+#define CPU_H
+
+// Host replacement for src/kernel/cpu.h, force-included like io.h. Interrupt
+// control is privileged, so it does nothing here; everything else runs the
+// real instruction. Code built against it still pays for its atomics.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NR_CPUS 1
+
+static inline uint32_t cpu_id(void) {
+    return 0;
+}
+
+#define EFLAGS_IF 0x200
+
+#define CPUID_EDX_PSE   (1 << 3)
+#define CPUID_EDX_TSC   (1 << 4)
+#define CPUID_EDX_MSR   (1 << 5)
+#define CPUID_EDX_APIC  (1 << 9)
+#define CPUID_EDX_MTRR  (1 << 12)
+#define CPUID_EDX_PAT   (1 << 16)
+
+static inline void cpu_cli(void) {
+}
+
+static inline void cpu_sti(void) {
+}
+
+static inline void cpu_relax(void) {
+    __asm__ volatile("pause" ::: "memory");
+}
+
+static inline void cpu_wc_flush(void) {
+    __asm__ volatile("sfence" ::: "memory");
+}
+
+static inline uint32_t irq_save(void) {
+    return EFLAGS_IF;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    (void)flags;
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    __asm__ volatile("cpuid"
+                     : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                     : "a"(leaf), "c"(0));
+}
+
+static inline bool cpu_has_edx_feature(uint32_t bit) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    return (edx & bit) != 0;
+}
+
+static inline uint64_t rdtsc(void) {
+    uint32_t low, high;
+    __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+#endif // CPU_H
@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "io.h"
+#include "idt.h"
+#include "pic.h"
+#include "keyboard.h"
+#include "uart.h"
+#include "task.h"
+#include "timer.h"
+
+struct host_io_stats host_io;
+uint16_t host_vga[HOST_VGA_CELLS];
+
+// Scancodes returned by the keyboard data port, in order
+static const uint8_t scancode_feed[] = {
+    KEY_L, KEY_S, 0x39, KEY_G, KEY_D, KEY_T, KEY_ENTER, KEY_BACKSPACE,
+    KEY_A | 0x80, KEY_F2, KEY_F1, KEY_Q, KEY_W, KEY_E, KEY_R, KEY_T | 0x80,
+};
+static size_t scancode_pos = 0;
+
+uint32_t host_port_read(uint16_t port) {
+    switch (port) {
+    case KEYBOARD_STATUS_PORT:
+        return 0x01;  // Output buffer always full
+    case KEYBOARD_DATA_PORT: {
+        uint8_t scancode = scancode_feed[scancode_pos];
+        scancode_pos = (scancode_pos + 1) % sizeof(scancode_feed);
+        return scancode;
+    }
+    case UART_PORT + 5:
+        return 0x20;  // Transmit holding register always empty
+    default:
+        return 0;
+    }
+}
+
+void host_mmio_fault(uintptr_t address) {
+    fprintf(stderr, "bench: MMIO write outside the fake VGA buffer: %#lx\n", (unsigned long)address);
+    abort();
+}
+
+// Kernel symbols the host objects reference but the benchmark never reaches
+void idt_register_handler(uint8_t vector, interrupt_handler_t handler) {
+    (void)vector;
+    (void)handler;
+}
+
+void pic_unmask_irq(uint8_t irq) {
+    (void)irq;
+}
+
+void pic_send_eoi(uint8_t irq) {
+    (void)irq;
+}
+
+void task_event_signal(task_event_t* ev) {
+    (void)ev;
+}
+
+uint32_t timer_now(void) {
+    return 0;
+}
+
+void gdt_flush(uint32_t gdt_ptr) {
+    (void)gdt_ptr;
+}
@@ -0,0 +1,72 @@
+#ifndef IO_H
+#define IO_H
+
+// Host replacement for src/kernel/io.h. It is force-included (-include) into
+// every translation unit of the benchmark, so its include guard shadows the
+// kernel header. Port and MMIO accesses are counted instead of performed.
+
+#include <stdint.h>
+
+#define HOST_VGA_ADDRESS 0xB8000
+#define HOST_VGA_CELLS   (80 * 25)
+
+struct host_io_stats {
+    uint64_t port_writes;
+    uint64_t port_reads;
+    uint64_t mmio_writes;
+};
+
+extern struct host_io_stats host_io;
+extern uint16_t host_vga[HOST_VGA_CELLS];
+
+uint32_t host_port_read(uint16_t port);
+void host_mmio_fault(uintptr_t address);
+
+// 8-bit I/O
+static inline void outb(uint16_t port, uint8_t value) {
+    (void)port;
+    (void)value;
+    host_io.port_writes++;
+}
+
+static inline uint8_t inb(uint16_t port) {
+    host_io.port_reads++;
+    return (uint8_t)host_port_read(port);
+}
+
+// 16-bit I/O
+static inline void outw(uint16_t port, uint16_t value) {
+    (void)port;
+    (void)value;
+    host_io.port_writes++;
+}
+
+static inline uint16_t inw(uint16_t port) {
+    host_io.port_reads++;
+    return (uint16_t)host_port_read(port);
+}
+
+// 32-bit I/O
+static inline void outl(uint16_t port, uint32_t value) {
+    (void)port;
+    (void)value;
+    host_io.port_writes++;
+}
+
+static inline uint32_t inl(uint16_t port) {
+    host_io.port_reads++;
+    return host_port_read(port);
+}
+
+// Memory-mapped I/O: the VGA text buffer is redirected to host_vga
+static inline void mmio_write16(volatile uint16_t* addr, uint16_t value) {
+    uintptr_t offset = (uintptr_t)addr - HOST_VGA_ADDRESS;
+
+    if (offset >= sizeof(host_vga)) {
+        host_mmio_fault((uintptr_t)addr);
+    }
+    host_vga[offset / 2] = value;
+    host_io.mmio_writes++;
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef PATCH_H
+#define PATCH_H
+
+// Host replacement for src/kernel/patch.h, force-included like io.h. Static
+// keys become plain flag tests since host code cannot be patched; the
+// benchmarks measure the kernel code with every key disabled.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct static_key {
+    const char* name;
+    bool enabled;
+};
+
+#define DEFINE_STATIC_KEY(var, key_name) struct static_key var = { key_name, false }
+#define DECLARE_STATIC_KEY(var) extern struct static_key var
+
+static inline bool static_branch(struct static_key* key) {
+    return key->enabled;
+}
+
+static inline bool static_key_enabled(const struct static_key* key) {
+    return key->enabled;
+}
+
+static inline void static_key_enable(struct static_key* key) {
+    key->enabled = true;
+}
+
+static inline void static_key_disable(struct static_key* key) {
+    key->enabled = false;
+}
+
+#endif // PATCH_H
@@ -4,6 +4,7 @@ MEMINFO  equ  1 << 1            ; provide memory map
 FLAGS    equ  MBALIGN | MEMINFO ; this is the Multiboot 'flag' field
 MAGIC    equ  0x1BADB002       ; 'magic number' lets bootloader find the header
 CHECKSUM equ -(MAGIC + FLAGS)   ; checksum of above, to prove we are multiboot
+STUB_MAGIC equ 0x4B345A4C       ; set in edx when entered from the boot stub
 
 section .multiboot
 align 4
@@ -11,6 +12,14 @@ align 4
     dd FLAGS
     dd CHECKSUM
 
+section .data
+align 4
+; Statistics left by the compressed image's boot stub, 0 when GRUB loaded
+; the kernel directly
+global boot_stub_info
+boot_stub_info:
+    dd 0
+
 section .bss
 align 16
 stack_bottom:
@@ -20,6 +29,24 @@ stack_top:
 section .text
 global _start:function (_start.end - _start)
 _start:
+    cmp edx, STUB_MAGIC
+    jne .clear_bss
+    mov [boot_stub_info], esi
+
+.clear_bss:
+    ; The boot stub only unpacks the file contents, so .bss (including the
+    ; stack) is cleared here rather than relied on from the loader
+    extern _bss_start
+    extern _kernel_end
+    mov ebp, eax
+    mov edi, _bss_start
+    mov ecx, _kernel_end
+    sub ecx, edi
+    xor eax, eax
+    cld
+    rep stosb
+    mov eax, ebp
+
     mov esp, stack_top
     push eax    ; Multiboot magic number
     push ebx    ; Multiboot info structure
@@ -0,0 +1,187 @@
+; Boot stub for the compressed kernel image. GRUB loads this image above the
+; kernel's memory region (see stub.ld); the stub unpacks the LZ4 payload
+; produced by tools/lz4pack.c to the kernel's link address and jumps to the
+; kernel's entry point with the Multiboot registers, ebx pointing at a copy
+; of the Multiboot information.
+
+; Multiboot header constants
+MBALIGN  equ  1 << 0            ; align loaded modules on page boundaries
+MEMINFO  equ  1 << 1            ; provide memory map
+FLAGS    equ  MBALIGN | MEMINFO ; this is the Multiboot 'flag' field
+MAGIC    equ  0x1BADB002       ; 'magic number' lets bootloader find the header
+CHECKSUM equ -(MAGIC + FLAGS)   ; checksum of above, to prove we are multiboot
+BOOTLOADER_MAGIC equ 0x2BADB002 ; in eax when a Multiboot loader started us
+
+; Multiboot information: the copy covers every field up to the framebuffer
+; ones. Only the fields holding no pointers are kept valid: memory sizes,
+; boot device and framebuffer.
+MBI_SIZE       equ 116
+MBI_SAFE_FLAGS equ (1 << 0) | (1 << 1) | (1 << 12)
+
+; Payload header written by lz4pack
+LZ4K_MAGIC   equ 0x4B345A4C     ; "LZ4K", also passed to the kernel in edx
+HDR_MAGIC    equ 0
+HDR_LOAD     equ 4
+HDR_ENTRY    equ 8
+HDR_RAW      equ 12
+HDR_PACKED   equ 16
+HDR_SIZE     equ 20
+
+CPUID_EDX_TSC equ 1 << 4
+
+section .multiboot
+align 4
+    dd MAGIC
+    dd FLAGS
+    dd CHECKSUM
+
+section .data
+align 4
+; Handed to the kernel in esi; layout matches struct boot_stub_info
+stub_info:
+.packed_size:   dd 0
+.raw_size:      dd 0
+.tsc_start:     dd 0, 0
+.tsc_end:       dd 0, 0
+
+has_tsc:        db 0
+
+section .rodata
+align 4
+payload:
+    incbin PAYLOAD
+
+section .bss
+align 4
+mbi_copy:
+    resb MBI_SIZE
+
+align 16
+stack_bottom:
+    resb 4096
+stack_top:
+
+section .text
+global _start
+_start:
+    mov esp, stack_top
+
+    ; GRUB only knows about this image at 16M, so it may have put the
+    ; Multiboot information, and what it points to, where the kernel is about
+    ; to be unpacked. The kernel gets a copy from up here instead, with the
+    ; pointer fields marked absent.
+    cmp eax, BOOTLOADER_MAGIC
+    jne .no_mbi
+    mov esi, ebx
+    mov edi, mbi_copy
+    mov ecx, MBI_SIZE
+    cld
+    rep movsb
+    and dword [mbi_copy], MBI_SAFE_FLAGS
+    mov ebx, mbi_copy
+    jmp .save_mbi
+.no_mbi:
+    xor ebx, ebx
+.save_mbi:
+    push eax    ; Multiboot magic number
+    push ebx    ; Multiboot info structure
+
+    mov eax, 1
+    cpuid
+    test edx, CPUID_EDX_TSC
+    jz .unpack
+    mov byte [has_tsc], 1
+    rdtsc
+    mov [stub_info.tsc_start], eax
+    mov [stub_info.tsc_start + 4], edx
+
+.unpack:
+    cmp dword [payload + HDR_MAGIC], LZ4K_MAGIC
+    jne .hang
+
+    mov eax, [payload + HDR_RAW]
+    mov [stub_info.raw_size], eax
+    mov eax, [payload + HDR_PACKED]
+    mov [stub_info.packed_size], eax
+
+    mov esi, payload + HDR_SIZE
+    lea ebx, [esi + eax]
+    mov edi, [payload + HDR_LOAD]
+    call lz4_decompress
+
+    ; A corrupt payload must not be jumped into
+    sub edi, [payload + HDR_LOAD]
+    cmp edi, [payload + HDR_RAW]
+    jne .hang
+
+    cmp byte [has_tsc], 0
+    je .enter
+    rdtsc
+    mov [stub_info.tsc_end], eax
+    mov [stub_info.tsc_end + 4], edx
+
+.enter:
+    mov ecx, [payload + HDR_ENTRY]
+    pop ebx
+    pop eax
+    mov edx, LZ4K_MAGIC
+    mov esi, stub_info
+    jmp ecx
+
+.hang:
+    cli
+    hlt
+    jmp .hang
+
+; Decode one LZ4 block.
+; In: esi = compressed data, ebx = end of compressed data, edi = destination
+; Out: edi = end of the decompressed data
+; Clobbers eax, ecx, edx, esi, ebp
+lz4_decompress:
+    cld
+.sequence:
+    movzx edx, byte [esi]       ; Token
+    inc esi
+
+    ; Literals, copied straight from the input
+    mov eax, edx
+    shr eax, 4
+    call .length
+    mov ecx, eax
+    rep movsb
+
+    ; The last sequence has no match
+    cmp esi, ebx
+    jae .done
+
+    movzx ebp, word [esi]       ; Match offset
+    add esi, 2
+    mov eax, edx
+    and eax, 0x0F
+    call .length
+    lea ecx, [eax + 4]
+
+    ; The match may overlap the bytes it produces; rep movsb copies forward
+    ; one byte at a time as far as the result is concerned
+    push esi
+    mov esi, edi
+    sub esi, ebp
+    rep movsb
+    pop esi
+    jmp .sequence
+
+.done:
+    ret
+
+; eax = 4-bit length field; a value of 15 continues in the following bytes
+.length:
+    cmp eax, 15
+    jne .length_done
+.length_byte:
+    movzx ecx, byte [esi]
+    inc esi
+    add eax, ecx
+    cmp ecx, 255
+    je .length_byte
+.length_done:
+    ret
@@ -0,0 +1,109 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "patch.h"
+
+// Only the bootstrap processor runs for now; per-CPU data is still indexed
+// by cpu_id() so it is ready for more
+#define NR_CPUS 1
+
+static inline uint32_t cpu_id(void) {
+    return 0;
+}
+
+// EFLAGS bits
+#define EFLAGS_IF 0x200
+
+// CPUID leaf 1 EDX feature bits
+#define CPUID_EDX_PSE   (1 << 3)
+#define CPUID_EDX_TSC   (1 << 4)
+#define CPUID_EDX_MSR   (1 << 5)
+#define CPUID_EDX_APIC  (1 << 9)
+#define CPUID_EDX_MTRR  (1 << 12)
+#define CPUID_EDX_PAT   (1 << 16)
+
+// Interrupt flag control
+static inline void cpu_cli(void) {
+    __asm__ volatile("cli" ::: "memory");
+}
+
+static inline void cpu_sti(void) {
+    __asm__ volatile("sti" ::: "memory");
+}
+
+static inline void cpu_hlt(void) {
+    __asm__ volatile("hlt" ::: "memory");
+}
+
+// Enable interrupts and halt in one go: sti only takes effect after the
+// next instruction, so no interrupt can slip in between the two.
+static inline void cpu_sti_hlt(void) {
+    __asm__ volatile("sti; hlt" ::: "memory");
+}
+
+// Spin-wait hint (pause, encoded as rep nop so older CPUs ignore it)
+static inline void cpu_relax(void) {
+    __asm__ volatile("rep; nop" ::: "memory");
+}
+
+// Drain the write-combining buffers so earlier stores to WC memory reach
+// the device: sfence where SSE has it, otherwise a locked instruction, which
+// also waits for them
+static inline void cpu_wc_flush(void) {
+    __asm__ volatile(ALTERNATIVE("lock; addl $0, (%%esp)", "sfence", FEATURE_EDX_SSE)
+                     ::: "memory", "cc");
+}
+
+static inline uint32_t cpu_save_flags(void) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+// Disable interrupts, returning the previous EFLAGS for irq_restore()
+static inline uint32_t irq_save(void) {
+    uint32_t flags = cpu_save_flags();
+    cpu_cli();
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        cpu_sti();
+    }
+}
+
+// CPUID
+static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    __asm__ volatile("cpuid"
+                     : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                     : "a"(leaf), "c"(0));
+}
+
+static inline bool cpu_has_edx_feature(uint32_t bit) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    return (edx & bit) != 0;
+}
+
+// Model specific registers
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t low, high;
+    __asm__ volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+    return ((uint64_t)high << 32) | low;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    __asm__ volatile("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+// Time stamp counter
+static inline uint64_t rdtsc(void) {
+    uint32_t low, high;
+    __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+#endif // CPU_H
@@ -0,0 +1,282 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "e1000.h"
+#include "pci.h"
+#include "pic.h"
+#include "idt.h"
+#include "cpu.h"
+#include "workqueue.h"
+#include "log.h"
+
+// Frames handled per poll before yielding to other deferred work
+#define POLL_BUDGET 64
+
+// Interrupt throttling: at most ~8000 interrupts/s (ITR counts 256 ns units)
+#define ITR_INTERVAL (1000000000 / (256 * 8000))
+
+#define E1000_RX_INTERRUPTS (E1000_ICR_RXT0 | E1000_ICR_RXO | E1000_ICR_RXDMT0 | E1000_ICR_LSC)
+
+// Descriptor rings and the packet buffers they point at, all preallocated.
+// Buffers migrate between the RX and TX rings: an echoed frame is sent from
+// the buffer it arrived in, and the RX slot takes the TX slot's old buffer.
+static volatile struct e1000_rx_desc rx_ring[E1000_RX_RING_SIZE] __attribute__((aligned(128)));
+static volatile struct e1000_tx_desc tx_ring[E1000_TX_RING_SIZE] __attribute__((aligned(128)));
+static uint8_t buffer_pool[E1000_RX_RING_SIZE + E1000_TX_RING_SIZE][E1000_BUFFER_SIZE] __attribute__((aligned(16)));
+static uint8_t* rx_buffers[E1000_RX_RING_SIZE];
+static uint8_t* tx_buffers[E1000_TX_RING_SIZE];
+
+static volatile uint8_t* mmio = NULL;
+static uint8_t irq_line = 0;
+static uint8_t mac_address[6];
+static e1000_rx_handler_t rx_handler = NULL;
+
+static uint16_t rx_next = 0;       // Next RX descriptor to check
+static uint16_t tx_next = 0;       // Next TX descriptor to fill
+static uint16_t tx_clean = 0;      // Oldest TX descriptor not yet reclaimed
+static uint16_t tx_in_flight = 0;
+
+static struct e1000_stats stats;
+
+static inline uint32_t e1000_read(uint32_t reg) {
+    return *(volatile uint32_t*)(mmio + reg);
+}
+
+static inline void e1000_write(uint32_t reg, uint32_t value) {
+    *(volatile uint32_t*)(mmio + reg) = value;
+}
+
+static void tx_reclaim(void) {
+    while (tx_in_flight > 0 && (tx_ring[tx_clean].status & E1000_TXD_STAT_DD)) {
+        tx_clean = (tx_clean + 1) % E1000_TX_RING_SIZE;
+        tx_in_flight--;
+    }
+}
+
+// Queue the frame in the buffer of RX slot rx_index for transmission by
+// trading buffers with the next free TX slot
+static bool tx_queue_rx_buffer(uint16_t rx_index, uint16_t len) {
+    if (tx_in_flight >= E1000_TX_RING_SIZE - 1) {
+        return false;
+    }
+
+    uint16_t t = tx_next;
+    uint8_t* frame = rx_buffers[rx_index];
+    rx_buffers[rx_index] = tx_buffers[t];
+    tx_buffers[t] = frame;
+
+    tx_ring[t].addr = (uint32_t)frame;
+    tx_ring[t].length = len;
+    tx_ring[t].cmd = E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS;
+    tx_ring[t].status = 0;
+
+    tx_next = (t + 1) % E1000_TX_RING_SIZE;
+    tx_in_flight++;
+    return true;
+}
+
+// Process up to budget received frames. Tail registers are written once per
+// call rather than once per frame.
+static uint32_t e1000_poll(uint32_t budget) {
+    uint32_t done = 0;
+    uint32_t sent = 0;
+    uint16_t last_rx = 0;
+
+    tx_reclaim();
+
+    while (done < budget) {
+        volatile struct e1000_rx_desc* desc = &rx_ring[rx_next];
+        if (!(desc->status & E1000_RXD_STAT_DD)) {
+            break;
+        }
+
+        uint16_t len = desc->length;
+        stats.rx_packets++;
+
+        if (desc->errors || !(desc->status & E1000_RXD_STAT_EOP)) {
+            stats.rx_dropped++;
+        } else if (rx_handler(rx_buffers[rx_next], &len)) {
+            if (tx_queue_rx_buffer(rx_next, len)) {
+                sent++;
+            } else {
+                stats.tx_dropped++;
+            }
+        }
+
+        // Hand the (possibly swapped) buffer back to the NIC
+        desc->addr = (uint32_t)rx_buffers[rx_next];
+        desc->status = 0;
+        last_rx = rx_next;
+        rx_next = (rx_next + 1) % E1000_RX_RING_SIZE;
+        done++;
+    }
+
+    if (done) {
+        e1000_write(E1000_RDT, last_rx);
+    }
+    if (sent) {
+        stats.tx_packets += sent;
+        e1000_write(E1000_TDT, tx_next);
+    }
+    return done;
+}
+
+// NAPI-style: the interrupt only schedules this poll. While a poll uses its
+// whole budget the NIC interrupt stays masked and the poll requeues itself
+// behind any other pending work; once the ring drains, interrupts return.
+static void e1000_poll_work(uint32_t arg __attribute__((unused))) {
+    stats.polls++;
+
+    if (e1000_poll(POLL_BUDGET) == POLL_BUDGET) {
+        work_post(e1000_poll_work, 0);
+        return;
+    }
+
+    e1000_write(E1000_IMS, E1000_RX_INTERRUPTS);
+}
+
+static void e1000_irq_handler(struct interrupt_frame* frame __attribute__((unused))) {
+    uint32_t cause = e1000_read(E1000_ICR);  // Reading acknowledges
+
+    if (cause) {
+        stats.interrupts++;
+        if (cause & E1000_ICR_LSC) {
+            e1000_write(E1000_CTRL, e1000_read(E1000_CTRL) | E1000_CTRL_SLU);
+        }
+
+        e1000_write(E1000_IMC, 0xFFFFFFFF);
+        if (!work_post(e1000_poll_work, 0)) {
+            e1000_write(E1000_IMS, E1000_RX_INTERRUPTS);
+        }
+    }
+
+    pic_send_eoi(irq_line);
+}
+
+static void e1000_setup_rx(void) {
+    for (int i = 0; i < E1000_RX_RING_SIZE; i++) {
+        rx_buffers[i] = buffer_pool[i];
+        rx_ring[i].addr = (uint32_t)rx_buffers[i];
+        rx_ring[i].status = 0;
+    }
+
+    e1000_write(E1000_RDBAL, (uint32_t)rx_ring);
+    e1000_write(E1000_RDBAH, 0);
+    e1000_write(E1000_RDLEN, sizeof(rx_ring));
+    e1000_write(E1000_RDH, 0);
+    e1000_write(E1000_RDT, E1000_RX_RING_SIZE - 1);
+    rx_next = 0;
+
+    // Coalescing is left to ITR rather than the per-packet delay timers
+    e1000_write(E1000_RDTR, 0);
+    e1000_write(E1000_RADV, 0);
+    e1000_write(E1000_RCTL, E1000_RCTL_EN | E1000_RCTL_BAM | E1000_RCTL_SECRC);
+}
+
+static void e1000_setup_tx(void) {
+    for (int i = 0; i < E1000_TX_RING_SIZE; i++) {
+        tx_buffers[i] = buffer_pool[E1000_RX_RING_SIZE + i];
+        tx_ring[i].addr = 0;
+        tx_ring[i].cmd = 0;
+        tx_ring[i].status = E1000_TXD_STAT_DD;
+    }
+
+    e1000_write(E1000_TDBAL, (uint32_t)tx_ring);
+    e1000_write(E1000_TDBAH, 0);
+    e1000_write(E1000_TDLEN, sizeof(tx_ring));
+    e1000_write(E1000_TDH, 0);
+    e1000_write(E1000_TDT, 0);
+    tx_next = 0;
+    tx_clean = 0;
+    tx_in_flight = 0;
+
+    e1000_write(E1000_TIDV, 0);
+    e1000_write(E1000_TIPG, 0x0060200A);
+    e1000_write(E1000_TCTL, E1000_TCTL_EN | E1000_TCTL_PSP | E1000_TCTL_CT | E1000_TCTL_COLD);
+}
+
+bool e1000_init(e1000_rx_handler_t handler) {
+    struct pci_device* dev = pci_find_device(E1000_VENDOR_ID, E1000_DEVICE_ID);
+    if (!dev) {
+        log_write_string("e1000: no device\n");
+        return false;
+    }
+    if (dev->bar[0] & PCI_BAR_IO) {
+        log_write_string("e1000: BAR0 is not a memory BAR\n");
+        return false;
+    }
+
+    // Memory is identity mapped, so the register window is used at its physical address
+    mmio = (volatile uint8_t*)(dev->bar[0] & PCI_BAR_MEM_MASK);
+    irq_line = dev->irq_line;
+    rx_handler = handler;
+    pci_enable_device(dev);
+
+    // Reset and keep every interrupt masked until the rings are set up
+    e1000_write(E1000_IMC, 0xFFFFFFFF);
+    e1000_write(E1000_CTRL, e1000_read(E1000_CTRL) | E1000_CTRL_RST);
+    while (e1000_read(E1000_CTRL) & E1000_CTRL_RST);
+    e1000_write(E1000_IMC, 0xFFFFFFFF);
+    e1000_read(E1000_ICR);
+
+    e1000_write(E1000_CTRL, e1000_read(E1000_CTRL) | E1000_CTRL_SLU);
+
+    // The receive address registers are loaded from the EEPROM on reset
+    uint32_t ral = e1000_read(E1000_RAL);
+    uint32_t rah = e1000_read(E1000_RAH);
+    for (int i = 0; i < 4; i++) {
+        mac_address[i] = (ral >> (i * 8)) & 0xFF;
+    }
+    mac_address[4] = rah & 0xFF;
+    mac_address[5] = (rah >> 8) & 0xFF;
+
+    for (int i = 0; i < 128; i++) {
+        e1000_write(E1000_MTA + i * 4, 0);
+    }
+
+    e1000_setup_rx();
+    e1000_setup_tx();
+
+    idt_register_handler(PIC1_OFFSET + irq_line, e1000_irq_handler);
+    pic_unmask_irq(irq_line);
+
+    e1000_write(E1000_ITR, ITR_INTERVAL);
+    e1000_write(E1000_IMS, E1000_RX_INTERRUPTS);
+
+    log_write_string("e1000: IRQ ");
+    log_write_hex(irq_line);
+    log_write_string(", link ");
+    log_write_string((e1000_read(E1000_STATUS) & 0x2) ? "up\n" : "down\n");
+    return true;
+}
+
+bool e1000_present(void) {
+    return mmio != NULL;
+}
+
+void e1000_get_mac(uint8_t mac[6]) {
+    for (int i = 0; i < 6; i++) {
+        mac[i] = mac_address[i];
+    }
+}
+
+void e1000_get_stats(struct e1000_stats* out) {
+    uint32_t flags = irq_save();
+
+    // The missed packet counter clears on read
+    stats.rx_dropped += e1000_read(E1000_MPC);
+    *out = stats;
+
+    irq_restore(flags);
+}
+
+// Frames the NIC has written that software has not processed yet
+uint32_t e1000_rx_ring_used(void) {
+    uint32_t head = e1000_read(E1000_RDH);
+    return (head + E1000_RX_RING_SIZE - rx_next) % E1000_RX_RING_SIZE;
+}
+
+// Frames queued for transmission and not yet reclaimed
+uint32_t e1000_tx_ring_used(void) {
+    return tx_in_flight;
+}
@@ -0,0 +1,113 @@
+#ifndef E1000_H
+#define E1000_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Intel 82540EM (QEMU's default e1000)
+#define E1000_VENDOR_ID 0x8086
+#define E1000_DEVICE_ID 0x100E
+
+// Register offsets
+#define E1000_CTRL     0x0000
+#define E1000_STATUS   0x0008
+#define E1000_ICR      0x00C0
+#define E1000_ITR      0x00C4
+#define E1000_IMS      0x00D0
+#define E1000_IMC      0x00D8
+#define E1000_RCTL     0x0100
+#define E1000_TCTL     0x0400
+#define E1000_TIPG     0x0410
+#define E1000_RDBAL    0x2800
+#define E1000_RDBAH    0x2804
+#define E1000_RDLEN    0x2808
+#define E1000_RDH      0x2810
+#define E1000_RDT      0x2818
+#define E1000_RDTR     0x2820
+#define E1000_RADV     0x282C
+#define E1000_TDBAL    0x3800
+#define E1000_TDBAH    0x3804
+#define E1000_TDLEN    0x3808
+#define E1000_TDH      0x3810
+#define E1000_TDT      0x3818
+#define E1000_TIDV     0x3820
+#define E1000_MPC      0x4010
+#define E1000_MTA      0x5200
+#define E1000_RAL      0x5400
+#define E1000_RAH      0x5404
+
+// CTRL bits
+#define E1000_CTRL_SLU   (1 << 6)
+#define E1000_CTRL_RST   (1 << 26)
+
+// RCTL bits
+#define E1000_RCTL_EN    (1 << 1)
+#define E1000_RCTL_BAM   (1 << 15)
+#define E1000_RCTL_SECRC (1 << 26)
+
+// TCTL bits
+#define E1000_TCTL_EN    (1 << 1)
+#define E1000_TCTL_PSP   (1 << 3)
+#define E1000_TCTL_CT    (0x10 << 4)
+#define E1000_TCTL_COLD  (0x40 << 12)
+
+// Interrupt causes
+#define E1000_ICR_TXDW   (1 << 0)
+#define E1000_ICR_LSC    (1 << 2)
+#define E1000_ICR_RXDMT0 (1 << 4)
+#define E1000_ICR_RXO    (1 << 6)
+#define E1000_ICR_RXT0   (1 << 7)
+
+// Descriptor bits
+#define E1000_RXD_STAT_DD  0x01
+#define E1000_RXD_STAT_EOP 0x02
+#define E1000_TXD_CMD_EOP  0x01
+#define E1000_TXD_CMD_IFCS 0x02
+#define E1000_TXD_CMD_RS   0x08
+#define E1000_TXD_STAT_DD  0x01
+
+#define E1000_RX_RING_SIZE 128
+#define E1000_TX_RING_SIZE 128
+#define E1000_BUFFER_SIZE  2048
+
+struct e1000_rx_desc {
+    uint64_t addr;
+    uint16_t length;
+    uint16_t checksum;
+    uint8_t status;
+    uint8_t errors;
+    uint16_t special;
+} __attribute__((packed));
+
+struct e1000_tx_desc {
+    uint64_t addr;
+    uint16_t length;
+    uint8_t cso;
+    uint8_t cmd;
+    uint8_t status;
+    uint8_t css;
+    uint16_t special;
+} __attribute__((packed));
+
+// Called for every received frame. Returns true when the frame was rewritten
+// in place into a reply of *len bytes that should be transmitted.
+typedef bool (*e1000_rx_handler_t)(uint8_t* frame, uint16_t* len);
+
+struct e1000_stats {
+    uint32_t rx_packets;
+    uint32_t tx_packets;
+    uint32_t rx_dropped;     // Missed by the NIC or rejected by the handler
+    uint32_t tx_dropped;     // Transmit ring full
+    uint32_t interrupts;
+    uint32_t polls;
+};
+
+// e1000 functions
+bool e1000_init(e1000_rx_handler_t handler);
+bool e1000_present(void);
+void e1000_get_mac(uint8_t mac[6]);
+void e1000_get_stats(struct e1000_stats* stats);
+uint32_t e1000_rx_ring_used(void);
+uint32_t e1000_tx_ring_used(void);
+
+#endif // E1000_H
@@ -2,6 +2,7 @@
 #define GDT_H
 
 #include <stdint.h>
+#include "task.h"
 
 // GDT Entry structure
 struct gdt_entry {
@@ -43,5 +44,6 @@ struct gdt_ptr {
 void init_gdt(void);
 void gdt_set_gate(int num, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran);
 void verify_gdt(void);
+int gdt_dump_task(task_t* task);
 
 #endif // GDT_H 
\ No newline at end of file
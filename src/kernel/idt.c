@@ -0,0 +1,119 @@
+#include "idt.h"
+#include "gdt.h"
+#include "cpu.h"
+#include "log.h"
+#include "terminal.h"
+#include "uart_tx.h"
+#include "uart.h"
+#include <stddef.h>
+
+// IDT entries
+static struct idt_entry idt[IDT_ENTRIES];
+static struct idt_ptr ip;
+
+// C handlers, indexed by vector
+static interrupt_handler_t handlers[IDT_ENTRIES];
+
+// Vector/stub pairs defined in idt_asm.s, terminated by vector -1
+struct isr_stub {
+    int32_t vector;
+    void (*stub)(void);
+};
+extern const struct isr_stub isr_stub_table[];
+
+// Assembly function to load the IDT
+extern void idt_flush(uint32_t);
+
+static const char* exception_names[32] = {
+    "Divide Error", "Debug", "NMI", "Breakpoint", "Overflow", "Bound Range Exceeded",
+    "Invalid Opcode", "Device Not Available", "Double Fault", "Coprocessor Segment Overrun",
+    "Invalid TSS", "Segment Not Present", "Stack-Segment Fault", "General Protection Fault",
+    "Page Fault", "Reserved", "x87 Floating-Point", "Alignment Check", "Machine Check",
+    "SIMD Floating-Point", "Virtualization", "Control Protection", "Reserved", "Reserved",
+    "Reserved", "Reserved", "Reserved", "Reserved", "Hypervisor Injection",
+    "VMM Communication", "Security", "Reserved"
+};
+
+static void idt_set_gate(uint8_t num, uint32_t base, uint16_t selector, uint8_t flags) {
+    idt[num].base_low = base & 0xFFFF;
+    idt[num].base_high = (base >> 16) & 0xFFFF;
+    idt[num].selector = selector;
+    idt[num].zero = 0;
+    idt[num].flags = flags;
+}
+
+static void append(char* line, size_t* len, const char* str) {
+    while (*str && *len < 79) {
+        line[(*len)++] = *str++;
+    }
+    line[*len] = '\0';
+}
+
+static void append_hex(char* line, size_t* len, uint32_t value) {
+    const char hex_chars[] = "0123456789ABCDEF";
+    char hex_str[11] = "0x";
+
+    for (int i = 0; i < 8; i++) {
+        hex_str[9 - i] = hex_chars[(value >> (i * 4)) & 0xF];
+    }
+    hex_str[10] = '\0';
+    append(line, len, hex_str);
+}
+
+// Unhandled CPU exception: report on both outputs and stop. The fault may
+// have hit with the log, UART or terminal lock held, so nothing here waits
+// for a lock.
+static void exception_panic(struct interrupt_frame* frame) {
+    char line[80];
+    size_t len = 0;
+
+    append(line, &len, "EXCEPTION: ");
+    append(line, &len, exception_names[frame->vector]);
+    append(line, &len, " err=");
+    append_hex(line, &len, frame->error_code);
+    append(line, &len, " eip=");
+    append_hex(line, &len, frame->eip);
+    append(line, &len, "\n");
+
+    // Log output still buffered for uart_tx_task goes out first
+    uart_tx_flush();
+    uart_panic_write(line, len);
+
+    terminal_panic_write("\n");
+    terminal_panic_write(line);
+
+    for (;;) {
+        cpu_cli();
+        cpu_hlt();
+    }
+}
+
+// Called from isr_common with interrupts disabled
+void interrupt_dispatch(struct interrupt_frame* frame) {
+    interrupt_handler_t handler = handlers[frame->vector & 0xFF];
+
+    if (handler) {
+        handler(frame);
+    } else if (frame->vector < 32) {
+        exception_panic(frame);
+    } else {
+        log_write_string("Unhandled interrupt ");
+        log_write_hex(frame->vector);
+        log_write_string("\n");
+    }
+}
+
+void idt_register_handler(uint8_t vector, interrupt_handler_t handler) {
+    handlers[vector] = handler;
+}
+
+void init_idt(void) {
+    ip.limit = sizeof(idt) - 1;
+    ip.base = (uint32_t)&idt;
+
+    for (const struct isr_stub* s = isr_stub_table; s->vector >= 0; s++) {
+        idt_set_gate((uint8_t)s->vector, (uint32_t)s->stub, GDT_KERNEL_CODE, IDT_GATE_INTERRUPT);
+    }
+
+    idt_flush((uint32_t)&ip);
+}
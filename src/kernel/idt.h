@@ -0,0 +1,40 @@
+#ifndef IDT_H
+#define IDT_H
+
+#include <stdint.h>
+
+// IDT Entry structure
+struct idt_entry {
+    uint16_t base_low;     // Lower 16 bits of handler address
+    uint16_t selector;     // Kernel code segment selector
+    uint8_t zero;          // Always zero
+    uint8_t flags;         // Type and attributes
+    uint16_t base_high;    // Upper 16 bits of handler address
+} __attribute__((packed));
+
+// IDT Pointer structure
+struct idt_ptr {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed));
+
+// Register state saved by the common interrupt stub in idt_asm.s
+struct interrupt_frame {
+    uint32_t gs, fs, es, ds;
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;
+    uint32_t vector, error_code;
+    uint32_t eip, cs, eflags;
+} __attribute__((packed));
+
+typedef void (*interrupt_handler_t)(struct interrupt_frame* frame);
+
+#define IDT_ENTRIES 256
+
+// Gate flags: present, ring 0, 32-bit interrupt gate
+#define IDT_GATE_INTERRUPT 0x8E
+
+// Function declarations
+void init_idt(void);
+void idt_register_handler(uint8_t vector, interrupt_handler_t handler);
+
+#endif // IDT_H
@@ -0,0 +1,167 @@
+[bits 32]
+
+global idt_flush
+global isr_stub_table
+extern interrupt_dispatch
+
+idt_flush:
+    mov eax, [esp+4]  ; Get the pointer to the IDT, passed as a parameter
+    lidt [eax]        ; Load the new IDT pointer
+    ret
+
+; Stub for vectors where the CPU does not push an error code: push a dummy one
+; so every frame has the same layout.
+%macro ISR_NOERR 1
+isr_stub_%1:
+    push dword 0
+    push dword %1
+    jmp isr_common
+%endmacro
+
+; Stub for vectors where the CPU already pushed an error code
+%macro ISR_ERR 1
+isr_stub_%1:
+    push dword %1
+    jmp isr_common
+%endmacro
+
+; Save the interrupted context as a struct interrupt_frame and dispatch in C
+isr_common:
+    pusha
+    push ds
+    push es
+    push fs
+    push gs
+
+    mov ax, 0x10      ; Kernel data segment
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    cld
+
+    push esp          ; struct interrupt_frame*
+    call interrupt_dispatch
+    add esp, 4
+
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    popa
+    add esp, 8        ; Drop vector and error code
+    iret
+
+; CPU exceptions (0x00-0x1F)
+ISR_NOERR 0
+ISR_NOERR 1
+ISR_NOERR 2
+ISR_NOERR 3
+ISR_NOERR 4
+ISR_NOERR 5
+ISR_NOERR 6
+ISR_NOERR 7
+ISR_ERR 8
+ISR_NOERR 9
+ISR_ERR 10
+ISR_ERR 11
+ISR_ERR 12
+ISR_ERR 13
+ISR_ERR 14
+ISR_NOERR 15
+ISR_NOERR 16
+ISR_ERR 17
+ISR_NOERR 18
+ISR_NOERR 19
+ISR_NOERR 20
+ISR_ERR 21
+ISR_NOERR 22
+ISR_NOERR 23
+ISR_NOERR 24
+ISR_NOERR 25
+ISR_NOERR 26
+ISR_NOERR 27
+ISR_NOERR 28
+ISR_ERR 29
+ISR_ERR 30
+ISR_NOERR 31
+
+; Legacy PIC IRQs (0x20-0x2F)
+ISR_NOERR 32
+ISR_NOERR 33
+ISR_NOERR 34
+ISR_NOERR 35
+ISR_NOERR 36
+ISR_NOERR 37
+ISR_NOERR 38
+ISR_NOERR 39
+ISR_NOERR 40
+ISR_NOERR 41
+ISR_NOERR 42
+ISR_NOERR 43
+ISR_NOERR 44
+ISR_NOERR 45
+ISR_NOERR 46
+ISR_NOERR 47
+
+; Local APIC timer
+ISR_NOERR 48
+
+; Local APIC spurious interrupt
+ISR_NOERR 255
+
+section .rodata
+align 4
+; Vector number and stub address for every installed gate, terminated by -1
+isr_stub_table:
+    dd 0, isr_stub_0
+    dd 1, isr_stub_1
+    dd 2, isr_stub_2
+    dd 3, isr_stub_3
+    dd 4, isr_stub_4
+    dd 5, isr_stub_5
+    dd 6, isr_stub_6
+    dd 7, isr_stub_7
+    dd 8, isr_stub_8
+    dd 9, isr_stub_9
+    dd 10, isr_stub_10
+    dd 11, isr_stub_11
+    dd 12, isr_stub_12
+    dd 13, isr_stub_13
+    dd 14, isr_stub_14
+    dd 15, isr_stub_15
+    dd 16, isr_stub_16
+    dd 17, isr_stub_17
+    dd 18, isr_stub_18
+    dd 19, isr_stub_19
+    dd 20, isr_stub_20
+    dd 21, isr_stub_21
+    dd 22, isr_stub_22
+    dd 23, isr_stub_23
+    dd 24, isr_stub_24
+    dd 25, isr_stub_25
+    dd 26, isr_stub_26
+    dd 27, isr_stub_27
+    dd 28, isr_stub_28
+    dd 29, isr_stub_29
+    dd 30, isr_stub_30
+    dd 31, isr_stub_31
+    dd 32, isr_stub_32
+    dd 33, isr_stub_33
+    dd 34, isr_stub_34
+    dd 35, isr_stub_35
+    dd 36, isr_stub_36
+    dd 37, isr_stub_37
+    dd 38, isr_stub_38
+    dd 39, isr_stub_39
+    dd 40, isr_stub_40
+    dd 41, isr_stub_41
+    dd 42, isr_stub_42
+    dd 43, isr_stub_43
+    dd 44, isr_stub_44
+    dd 45, isr_stub_45
+    dd 46, isr_stub_46
+    dd 47, isr_stub_47
+    dd 48, isr_stub_48
+    dd 255, isr_stub_255
+    dd -1, 0
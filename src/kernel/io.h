@@ -2,13 +2,16 @@
 #define IO_H
 
 #include <stdint.h>
+#include "stats.h"
 
 // 8-bit I/O
 static inline void outb(uint16_t port, uint8_t value) {
+    stats_inc(STAT_PORT_WRITES);
     __asm__ volatile("outb %0, %1" : : "a"(value), "Nd"(port));
 }
 
 static inline uint8_t inb(uint16_t port) {
+    stats_inc(STAT_PORT_READS);
     uint8_t ret;
     __asm__ volatile("inb %1, %0" : "=a"(ret) : "Nd"(port));
     return ret;
@@ -16,10 +19,12 @@ static inline uint8_t inb(uint16_t port) {
 
 // 16-bit I/O
 static inline void outw(uint16_t port, uint16_t value) {
+    stats_inc(STAT_PORT_WRITES);
     __asm__ volatile("outw %0, %1" : : "a"(value), "Nd"(port));
 }
 
 static inline uint16_t inw(uint16_t port) {
+    stats_inc(STAT_PORT_READS);
     uint16_t ret;
     __asm__ volatile("inw %1, %0" : "=a"(ret) : "Nd"(port));
     return ret;
@@ -27,13 +32,20 @@ static inline uint16_t inw(uint16_t port) {
 
 // 32-bit I/O
 static inline void outl(uint16_t port, uint32_t value) {
+    stats_inc(STAT_PORT_WRITES);
     __asm__ volatile("outl %0, %1" : : "a"(value), "Nd"(port));
 }
 
 static inline uint32_t inl(uint16_t port) {
+    stats_inc(STAT_PORT_READS);
     uint32_t ret;
     __asm__ volatile("inl %1, %0" : "=a"(ret) : "Nd"(port));
     return ret;
 }
 
+// Memory-mapped I/O
+static inline void mmio_write16(volatile uint16_t* addr, uint16_t value) {
+    *addr = value;
+}
+
 #endif 
\ No newline at end of file
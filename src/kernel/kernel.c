@@ -3,16 +3,83 @@
 #include <stdbool.h>
 #include "io.h"
 #include "uart.h"
+#include "log.h"
 #include "terminal.h"
 #include "keyboard.h"
 #include "gdt.h"
 #include "stack.h"
+#include "idt.h"
+#include "pic.h"
+#include "timer.h"
+#include "cpu.h"
+#include "tsc.h"
+#include "pci.h"
+#include "virtio_console.h"
+#include "net.h"
+#include "workqueue.h"
+#include "task.h"
+#include "uart_tx.h"
+#include "math64.h"
+#include "patch.h"
+#include "lock.h"
+#include "stats.h"
+#include "paging.h"
 
 
+// Left by the boot stub of a compressed kernel image (src/boot/stub.asm)
+struct boot_stub_info {
+    uint32_t packed_size;
+    uint32_t raw_size;
+    uint64_t tsc_start;      // Stub entry
+    uint64_t tsc_end;        // Decompression finished; 0 without a TSC
+} __attribute__((packed));
+
+// Set by boot.asm, NULL when the kernel was loaded uncompressed
+extern struct boot_stub_info* boot_stub_info;
+
+#define MULTIBOOT_BOOTLOADER_MAGIC 0x2BADB002
+#define MULTIBOOT_INFO_FRAMEBUFFER (1 << 12)
+#define MULTIBOOT_FRAMEBUFFER_TEXT 2
+
+// Multiboot information, up to the framebuffer fields
+struct multiboot_info {
+    uint32_t flags;
+    uint32_t mem_lower;
+    uint32_t mem_upper;
+    uint32_t boot_device;
+    uint32_t cmdline;
+    uint32_t mods_count;
+    uint32_t mods_addr;
+    uint32_t syms[4];
+    uint32_t mmap_length;
+    uint32_t mmap_addr;
+    uint32_t drives_length;
+    uint32_t drives_addr;
+    uint32_t config_table;
+    uint32_t boot_loader_name;
+    uint32_t apm_table;
+    uint32_t vbe_control_info;
+    uint32_t vbe_mode_info;
+    uint16_t vbe_mode;
+    uint16_t vbe_interface_seg;
+    uint16_t vbe_interface_off;
+    uint16_t vbe_interface_len;
+    uint64_t framebuffer_addr;
+    uint32_t framebuffer_pitch;
+    uint32_t framebuffer_width;
+    uint32_t framebuffer_height;
+    uint8_t framebuffer_bpp;
+    uint8_t framebuffer_type;
+} __attribute__((packed));
+
 // Command buffer
 static char command_buffer[256];
 static size_t command_length = 0;
 
+// The shell, and the long-running command it is waiting for
+static task_t shell_task;
+static task_t command_task;
+
 // Custom strlen implementation
 static size_t strlen(const char* str) {
     size_t len = 0;
@@ -31,15 +98,170 @@ static int strcmp(const char* s1, const char* s2) {
     return *(unsigned char*)s1 - *(unsigned char*)s2;
 }
 
+// Whether str begins with prefix
+static bool starts_with(const char* str, const char* prefix) {
+    while (*prefix) {
+        if (*str++ != *prefix++) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Console throughput benchmark: bytes written per run
+#define CONBENCH_BYTES (32 * 1024)
+
+static const char conbench_line[] =
+    "conbench: the quick brown fox jumps over the lazy dog 0123456789\n";
+
+static void print_throughput(const char* name, uint64_t cycles) {
+    uint32_t us = (uint32_t)tsc_to_us(cycles);
+    if (us == 0) {
+        us = 1;
+    }
+
+    terminal_writestring(name);
+    terminal_writedec(CONBENCH_BYTES);
+    terminal_writestring(" bytes in ");
+    terminal_writedec(us);
+    terminal_writestring(" us, ");
+    terminal_writedec(CONBENCH_BYTES * 1000u / us);
+    terminal_writestring(" KB/s\n");
+}
+
+// Compare the UART and virtio-console transmit paths on the same output
+static void console_benchmark(void) {
+    const size_t line_len = sizeof(conbench_line) - 1;
+
+    uint64_t start = rdtsc_ordered();
+    for (size_t sent = 0; sent < CONBENCH_BYTES; sent += line_len) {
+        for (size_t i = 0; i < line_len; i++) {
+            uart_write_char(conbench_line[i]);
+        }
+    }
+    print_throughput("uart:   ", rdtsc_ordered() - start);
+
+    if (!virtio_console_present()) {
+        terminal_writestring("virtio: no device\n");
+        return;
+    }
+
+    struct virtio_console_stats before, after;
+    virtio_console_get_stats(&before);
+    start = rdtsc_ordered();
+    for (size_t sent = 0; sent < CONBENCH_BYTES; sent += line_len) {
+        virtio_console_write(conbench_line, line_len);
+    }
+    virtio_console_drain();
+    print_throughput("virtio: ", rdtsc_ordered() - start);
+
+    virtio_console_get_stats(&after);
+    terminal_writestring("virtio: ");
+    terminal_writedec(after.buffers - before.buffers);
+    terminal_writestring(" buffers, ");
+    terminal_writedec(after.kicks - before.kicks);
+    terminal_writestring(" notifications\n");
+}
+
+// Full-screen redraws per run of the VGA benchmark
+#define VGABENCH_REDRAWS 200
+
+static uint32_t time_redraws(enum mem_type type) {
+    paging_set_type(VGA_ADDRESS, VGA_MEMORY_SIZE, type);
+
+    uint64_t start = rdtsc_ordered();
+    for (int i = 0; i < VGABENCH_REDRAWS; i++) {
+        terminal_redraw();
+    }
+    return (uint32_t)div_u64_u32(rdtsc_ordered() - start, VGABENCH_REDRAWS, NULL);
+}
+
+static void print_redraw(const char* name, uint32_t cycles) {
+    terminal_writestring(name);
+    terminal_writedec(cycles);
+    terminal_writestring(" cycles per redraw (");
+    terminal_writedec((uint32_t)tsc_to_ns(cycles));
+    terminal_writestring(" ns)\n");
+}
+
+// Compare full-screen redraws with VGA memory uncached and write-combining
+static void vga_benchmark(void) {
+    if (!paging_enabled()) {
+        terminal_writestring("vgabench: no PAT, video memory is always uncached\n");
+        return;
+    }
+
+    uint32_t uc = time_redraws(MEM_UC);
+    uint32_t wc = time_redraws(MEM_WC);
+
+    print_redraw("uncached:        ", uc);
+    print_redraw("write-combining: ", wc);
+    if (wc) {
+        uint32_t ratio = uc * 10 / wc;
+        terminal_writestring("speedup: ");
+        terminal_writedec(ratio / 10);
+        terminal_putchar('.');
+        terminal_writedec(ratio % 10);
+        terminal_writestring("x\n");
+    }
+}
+
 void handle_command(void) {
     command_buffer[command_length] = '\0';
+    stats_inc(STAT_SHELL_COMMANDS);
     
     if (strcmp(command_buffer, "clear") == 0) {
         terminal_clear();
-    } else if (strcmp(command_buffer, "stack") == 0) {
-        print_kernel_stack();
-    } else if (strcmp(command_buffer, "gdt") == 0) {
-        verify_gdt();
+    } else if (strcmp(command_buffer, "uptime") == 0) {
+        terminal_writestring("Up ");
+        terminal_writedec(timer_now());
+        terminal_writestring(" ms (clock event: ");
+        terminal_writestring(timer_clockevent_name());
+        terminal_writestring(")\n");
+    } else if (strcmp(command_buffer, "lspci") == 0) {
+        pci_print_devices();
+    } else if (strcmp(command_buffer, "log uart") == 0) {
+        log_set_sinks(LOG_SINK_UART);
+    } else if (strcmp(command_buffer, "log virtio") == 0) {
+        if (!log_set_sinks(LOG_SINK_VIRTIO)) {
+            terminal_writestring("virtio console not present\n");
+        }
+    } else if (strcmp(command_buffer, "log both") == 0) {
+        if (!log_set_sinks(LOG_SINK_UART | LOG_SINK_VIRTIO)) {
+            terminal_writestring("virtio console not present\n");
+        }
+    } else if (strcmp(command_buffer, "mirror") == 0) {
+        terminal_set_mirror(!terminal_get_mirror());
+        terminal_writestring(terminal_get_mirror() ? "Mirroring on\n" : "Mirroring off\n");
+    } else if (strcmp(command_buffer, "conbench") == 0) {
+        console_benchmark();
+    } else if (strcmp(command_buffer, "vgabench") == 0) {
+        vga_benchmark();
+    } else if (strcmp(command_buffer, "net stats") == 0) {
+        net_print_stats();
+    } else if (strcmp(command_buffer, "workq") == 0) {
+        work_print_stats();
+    } else if (strcmp(command_buffer, "stats") == 0) {
+        stats_print();
+    } else if (strcmp(command_buffer, "stats dump") == 0) {
+        stats_dump_serial();
+    } else if (strcmp(command_buffer, "locks") == 0) {
+        lock_print_stats();
+    } else if (strcmp(command_buffer, "keys") == 0) {
+        static_key_print();
+    } else if (starts_with(command_buffer, "key ")) {
+        struct static_key* key = static_key_find(command_buffer + 4);
+        if (!key) {
+            terminal_writestring("No such key\n");
+        } else {
+            if (static_key_enabled(key)) {
+                static_key_disable(key);
+            } else {
+                static_key_enable(key);
+            }
+            terminal_writestring(key->name);
+            terminal_writestring(static_key_enabled(key) ? " on\n" : " off\n");
+        }
     } else if (strcmp(command_buffer, "poweroff") == 0) {
         // Try ACPI shutdown first
         outw(0x604, 0x2000);  // QEMU poweroff
@@ -48,39 +270,231 @@ void handle_command(void) {
         // If that fails, try VirtualBox shutdown
         outw(0x4004, 0x3400); // VirtualBox poweroff
     } else {
+        stats_inc(STAT_SHELL_UNKNOWN);
         terminal_writestring("\nUnknown command. Available commands:\n");
         terminal_writestring("clear     - Clear the screen\n");
         terminal_writestring("stack     - Print kernel stack trace\n");
         terminal_writestring("gdt       - Print GDT contents\n");
+        terminal_writestring("uptime    - Print time since boot\n");
+        terminal_writestring("lspci     - List PCI devices\n");
+        terminal_writestring("log uart|virtio|both - Select log output\n");
+        terminal_writestring("mirror    - Toggle terminal mirroring to the log\n");
+        terminal_writestring("conbench  - Compare UART and virtio-console throughput\n");
+        terminal_writestring("vgabench  - Time screen redraws with uncached and write-combining VGA memory\n");
+        terminal_writestring("net stats - Print network packet rates and ring usage\n");
+        terminal_writestring("workq     - Print deferred work queue statistics\n");
+        terminal_writestring("stats     - Print kernel counters\n");
+        terminal_writestring("stats dump - Write kernel counters to the log (serial port)\n");
+        terminal_writestring("locks     - Print the most contended locks\n");
+        terminal_writestring("keys      - List static keys\n");
+        terminal_writestring("key NAME  - Toggle a static key\n");
         terminal_writestring("poweroff  - Shut down the system\n");
     }
     
     command_length = 0;
 }
 
-void kernel_main(uint32_t magic __attribute__((unused)), void* mb_info __attribute__((unused))) {
+// Commands that run as tasks of their own, so that they do not hold up
+// everything else until they finish
+static bool start_command_task(void) {
+    command_buffer[command_length] = '\0';
+
+    if (strcmp(command_buffer, "stack") == 0) {
+        task_start(&command_task, stack_dump_task, 0);
+    } else if (strcmp(command_buffer, "gdt") == 0) {
+        task_start(&command_task, gdt_dump_task, 0);
+    } else {
+        return false;
+    }
+
+    stats_inc(STAT_SHELL_COMMANDS);
+    command_length = 0;
+    return true;
+}
+
+// Line editing; returns true once a command line is complete
+static bool handle_scancode(uint8_t scancode) {
+    if (!keyboard_is_released(scancode)) {  // Only process key press, not release
+        stats_inc(STAT_SHELL_KEYSTROKES);
+        char ascii = keyboard_scancode_to_ascii(scancode);
+        uint8_t keycode = keyboard_get_keycode(scancode);
+            
+        // Handle screen switching with F1-F12
+        if (keycode >= KEY_F1 && keycode <= KEY_F10) {
+            uint8_t screen_num = keycode - KEY_F1;
+            if (screen_num < NUM_SCREENS) {
+                terminal_switch_screen(screen_num);
+            }
+            return false;
+        }
+        // Handle F11 and F12 separately since they have different scancodes
+        else if (keycode == KEY_F11) {
+            if (10 < NUM_SCREENS) {
+                terminal_switch_screen(10);
+            }
+            return false;
+        }
+        else if (keycode == KEY_F12) {
+            if (11 < NUM_SCREENS) {
+                terminal_switch_screen(11);
+            }
+            return false;
+        }
+            
+        // Handle backspace
+        if (ascii == '\b' && command_length > 0) {
+            command_length--;
+            terminal_putchar('\b');
+        }
+        // Handle enter
+        else if (ascii == '\n') {
+            terminal_putchar('\n');
+            return true;
+        }
+        // Handle regular characters
+        else if ((ascii >= 'a' && ascii <= 'z') || ascii == ' ') {
+            if (command_length < sizeof(command_buffer) - 1) {
+                command_buffer[command_length++] = ascii;
+                terminal_putchar(ascii);
+            }
+        }
+    }
+    return false;
+}
+
+static int shell_fn(task_t* t) {
+    static uint8_t scancode;
+
+    TASK_BEGIN(t);
+    terminal_writestring("> ");
+    while (1) {
+        TASK_AWAIT(t, &keyboard_event, keyboard_read_scancode(&scancode));
+        if (!handle_scancode(scancode)) {
+            continue;
+        }
+
+        if (start_command_task()) {
+            TASK_AWAIT(t, &command_task.exit, task_done(&command_task));
+        } else {
+            handle_command();
+        }
+        terminal_writestring("> ");
+    }
+    TASK_END(t);
+}
+
+static void report_boot_image(void) {
+    const struct boot_stub_info* info = boot_stub_info;
+
+    if (!info) {
+        log_write_string("Kernel image loaded uncompressed\n");
+        return;
+    }
+
+    log_write_string("Kernel image: ");
+    log_write_dec(info->packed_size);
+    log_write_string(" bytes compressed, ");
+    log_write_dec(info->raw_size);
+    log_write_string(" unpacked (");
+    if (info->raw_size) {
+        log_write_dec((uint32_t)div_u64_u32((uint64_t)info->packed_size * 100, info->raw_size, NULL));
+    }
+    log_write_string("%)\n");
+
+    if (info->tsc_end) {
+        log_write_string("Decompressed in ");
+        log_write_dec((uint32_t)tsc_to_us(info->tsc_end - info->tsc_start));
+        log_write_string(" us\n");
+    }
+}
+
+// Logs "<what> at <base> write-combining" only if the mapping took effect
+static void map_write_combining(const char* what, uint32_t base, uint32_t size) {
+    log_write_string(what);
+    log_write_string(" at ");
+    log_write_hex(base);
+    log_write_string(paging_set_type(base, size, MEM_WC) ?
+                     " write-combining\n" : " could not be made write-combining\n");
+}
+
+// Make linear framebuffers write-combining: the one the boot loader set up
+// if any, and the display controller's prefetchable BAR
+static void map_framebuffers(uint32_t magic, const struct multiboot_info* mb_info) {
+    if (!paging_enabled()) {
+        return;
+    }
+
+    if (magic == MULTIBOOT_BOOTLOADER_MAGIC && mb_info &&
+        (mb_info->flags & MULTIBOOT_INFO_FRAMEBUFFER) &&
+        mb_info->framebuffer_type != MULTIBOOT_FRAMEBUFFER_TEXT &&
+        mb_info->framebuffer_addr < 0x100000000ULL) {
+        // The loader's geometry is not trusted to be sane
+        uint64_t size = (uint64_t)mb_info->framebuffer_pitch * mb_info->framebuffer_height;
+        if (size == 0 || size > 0xFFFFFFFF) {
+            log_write_string("Boot framebuffer has an unusable size, left uncached\n");
+        } else {
+            map_write_combining("Boot framebuffer", (uint32_t)mb_info->framebuffer_addr,
+                                (uint32_t)size);
+        }
+    }
+
+    struct pci_device* display = pci_find_class(PCI_CLASS_DISPLAY);
+    if (!display) {
+        return;
+    }
+    for (int bar = 0; bar < 6; bar++) {
+        if ((display->bar[bar] & (PCI_BAR_IO | PCI_BAR_PREFETCH)) != PCI_BAR_PREFETCH) {
+            continue;
+        }
+        // A 64-bit BAR is only usable here if it was placed below 4 GiB
+        if ((display->bar[bar] & PCI_BAR_MEM_64) && (bar == 5 || display->bar[bar + 1])) {
+            break;
+        }
+        uint32_t base = display->bar[bar] & PCI_BAR_MEM_MASK;
+        uint32_t size = pci_bar_size(display, bar);
+        if (base && size) {
+            map_write_combining("Linear framebuffer", base, size);
+        }
+        break;
+    }
+}
+
+void kernel_main(uint32_t magic, void* mb_info) {
     // Initialize UART first for debugging
     uart_init();
-    uart_write_string("UART initialized\n");
+    log_write_string("UART initialized\n");
+    
+    // Patch in CPU-specific instruction sequences before anything uses them
+    patch_init();
+    
+    // Identity-mapped paging, so video memory can be write-combining
+    if (paging_init()) {
+        map_write_combining("VGA text memory", VGA_ADDRESS, VGA_MEMORY_SIZE);
+    }
     
     // Initialize GDT
     init_gdt();
-    uart_write_string("GDT initialized\n");
+    log_write_string("GDT initialized\n");
+    
+    // Initialize interrupts
+    init_idt();
+    pic_init();
+    log_write_string("IDT initialized\n");
     
     // Initialize keyboard
     keyboard_init();
-    uart_write_string("Keyboard initialized\n");
+    log_write_string("Keyboard initialized\n");
     
     // Initialize VGA
     terminal_initialize();
-    uart_write_string("Terminal initialized\n");
+    log_write_string("Terminal initialized\n");
     
     // Enable cursor
     terminal_enable_cursor();
     
     // Set terminal color
     terminal_setcolor(vga_entry_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK));
-    uart_write_string("Terminal color set\n");
+    log_write_string("Terminal color set\n");
     
     // Print welcome message
     terminal_writestring("Hello from kernel_main()\n");
@@ -90,67 +504,51 @@ void kernel_main(uint32_t magic __attribute__((unused)), void* mb_info __attribu
     terminal_writestring("Type 'stack' to print kernel stack trace\n");
     terminal_writestring("Type 'gdt' to print GDT contents\n");
     terminal_writestring("Type 'poweroff' to shut down the system\n");
-    uart_write_string("Welcome message printed\n");
+    log_write_string("Welcome message printed\n");
+    
+    // Initialize timers
+    timer_init();
+    log_write_string("Timers initialized\n");
+    report_boot_image();
+    
+    // Initialize PCI devices
+    pci_init();
+    virtio_console_init();
+    net_init();
+    log_write_string("PCI initialized\n");
+    map_framebuffers(magic, mb_info);
+    
+    // Serial log output goes through a buffer from here on
+    uart_tx_init();
     
     // Initialize command
     command_length = 0;
-    uart_write_string("Command buffer initialized\n");
+    log_write_string("Command buffer initialized\n");
     
-    // Show prompt
-    terminal_writestring("> ");
-    uart_write_string("Prompt shown\n");
+    // Start the shell; it shows the prompt once the main loop runs it
+    task_start(&shell_task, shell_fn, 0);
+    log_write_string("Shell started\n");
     
-    uart_write_string("Entering main loop\n");
+    // Time to prompt, measured from the first instruction of the boot stub
+    if (boot_stub_info && boot_stub_info->tsc_end) {
+        log_write_string("Boot stub to main loop: ");
+        log_write_dec((uint32_t)tsc_to_us(rdtsc_ordered() - boot_stub_info->tsc_start));
+        log_write_string(" us\n");
+    }
+    log_write_string("Entering main loop\n");
+    cpu_sti();
     
     while (1) {
-        if (keyboard_is_key_pressed()) {
-            uint8_t scancode = keyboard_get_scancode();
-            
-            if (!keyboard_is_released(scancode)) {  // Only process key press, not release
-                char ascii = keyboard_scancode_to_ascii(scancode);
-                uint8_t keycode = keyboard_get_keycode(scancode);
-                
-                // Handle screen switching with F1-F12
-                if (keycode >= KEY_F1 && keycode <= KEY_F10) {
-                    uint8_t screen_num = keycode - KEY_F1;
-                    if (screen_num < NUM_SCREENS) {
-                        terminal_switch_screen(screen_num);
-                    }
-                    continue;
-                }
-                // Handle F11 and F12 separately since they have different scancodes
-                else if (keycode == KEY_F11) {
-                    if (10 < NUM_SCREENS) {
-                        terminal_switch_screen(10);
-                    }
-                    continue;
-                }
-                else if (keycode == KEY_F12) {
-                    if (11 < NUM_SCREENS) {
-                        terminal_switch_screen(11);
-                    }
-                    continue;
-                }
-                
-                // Handle backspace
-                if (ascii == '\b' && command_length > 0) {
-                    command_length--;
-                    terminal_putchar('\b');
-                }
-                // Handle enter
-                else if (ascii == '\n') {
-                    terminal_putchar('\n');
-                    handle_command();
-                    terminal_writestring("> ");
-                }
-                // Handle regular characters
-                else if ((ascii >= 'a' && ascii <= 'z') || ascii == ' ') {
-                    if (command_length < sizeof(command_buffer) - 1) {
-                        command_buffer[command_length++] = ascii;
-                        terminal_putchar(ascii);
-                    }
-                }
-            }
+        // Sleep until the next interrupt when there is no deferred work. The
+        // check runs with interrupts off so an interrupt posting work cannot
+        // slip in between it and the hlt.
+        cpu_cli();
+        if (!work_pending()) {
+            cpu_sti_hlt();
+            continue;
         }
+        cpu_sti();
+        
+        work_run();
     }
-} 
\ No newline at end of file
+}
@@ -1,5 +1,9 @@
 #include "keyboard.h"
 #include "io.h"
+#include "idt.h"
+#include "pic.h"
+#include "task.h"
+#include "stats.h"
 
 // Keyboard scancode to ASCII mapping
 static const char scancode_to_ascii[] = {
@@ -11,8 +15,48 @@ static const char scancode_to_ascii[] = {
     '\0', '\0', '\0', '\0', '\0', '{', '\0', '\0', '[', '\0', ']', '\0', '\0', '}'
 };
 
+// Scancodes received by the interrupt handler and not yet consumed. The
+// handler is the only writer of head and the consumer the only writer of
+// tail, so no lock is needed.
+#define SCANCODE_BUFFER_SIZE 64   // Power of two
+static uint8_t scancode_buffer[SCANCODE_BUFFER_SIZE];
+static volatile uint32_t scancode_head = 0;
+static volatile uint32_t scancode_tail = 0;
+
+// Signalled whenever new scancodes are buffered
+task_event_t keyboard_event;
+
+// Only drain the controller here; translation and everything it triggers
+// runs later in task context with interrupts enabled.
+static void keyboard_irq_handler(struct interrupt_frame* frame __attribute__((unused))) {
+    stats_inc(STAT_KEYBOARD_IRQS);
+    while (keyboard_is_key_pressed()) {
+        uint8_t scancode = keyboard_get_scancode();
+        stats_inc(STAT_KEYBOARD_SCANCODES);
+        if (scancode_head - scancode_tail < SCANCODE_BUFFER_SIZE) {
+            scancode_buffer[scancode_head % SCANCODE_BUFFER_SIZE] = scancode;
+            scancode_head = scancode_head + 1;
+        } else {
+            stats_inc(STAT_KEYBOARD_DROPPED);
+        }
+    }
+    task_event_signal(&keyboard_event);
+    pic_send_eoi(IRQ_KEYBOARD);
+}
+
+bool keyboard_read_scancode(uint8_t* scancode) {
+    if (scancode_tail == scancode_head) {
+        return false;
+    }
+
+    *scancode = scancode_buffer[scancode_tail % SCANCODE_BUFFER_SIZE];
+    scancode_tail = scancode_tail + 1;
+    return true;
+}
+
 void keyboard_init(void) {
-    // Nothing to initialize for now
+    idt_register_handler(PIC1_OFFSET + IRQ_KEYBOARD, keyboard_irq_handler);
+    pic_unmask_irq(IRQ_KEYBOARD);
 }
 
 bool keyboard_is_key_pressed(void) {
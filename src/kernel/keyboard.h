@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "task.h"
 
 // Keyboard ports
 #define KEYBOARD_PORT 0x60
@@ -54,8 +55,12 @@ enum key_scancodes {
     KEY_F12 = 0x58,
 };
 
+// Signalled when scancodes are available from keyboard_read_scancode()
+extern task_event_t keyboard_event;
+
 // Keyboard functions
 void keyboard_init(void);
+bool keyboard_read_scancode(uint8_t* scancode);
 bool keyboard_is_key_pressed(void);
 uint8_t keyboard_get_scancode(void);
 bool keyboard_is_released(uint8_t scancode);
@@ -0,0 +1,93 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "lapic.h"
+#include "cpu.h"
+#include "pit.h"
+#include "idt.h"
+#include "log.h"
+
+#define SVR_APIC_ENABLE   0x100
+#define LVT_MASKED        0x10000
+#define TIMER_DIVIDE_16   0x3
+
+// Calibration window: 10 ms worth of PIT ticks
+#define CALIBRATE_MS 10
+#define CALIBRATE_PIT_COUNT (PIT_FREQUENCY / (1000 / CALIBRATE_MS))
+
+// Memory is identity mapped, so the register page is accessed at its physical address
+static volatile uint32_t* lapic_base = 0;
+static uint32_t ticks_per_ms = 0;
+
+// Spurious interrupts must not be acknowledged
+static void lapic_spurious_handler(struct interrupt_frame* frame __attribute__((unused))) {
+}
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return lapic_base[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value) {
+    lapic_base[reg / 4] = value;
+}
+
+// Measure the timer rate (bus clock / 16) against the PIT
+static void lapic_timer_calibrate(void) {
+    lapic_write(LAPIC_REG_TIMER_DIV, TIMER_DIVIDE_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LVT_MASKED | LAPIC_TIMER_VECTOR);
+
+    pit_delay_start(CALIBRATE_PIT_COUNT);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0xFFFFFFFF);
+    while (!pit_delay_expired());
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_REG_TIMER_CUR);
+
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+    ticks_per_ms = elapsed / CALIBRATE_MS;
+}
+
+bool lapic_init(void) {
+    if (!cpu_has_edx_feature(CPUID_EDX_APIC) || !cpu_has_edx_feature(CPUID_EDX_MSR)) {
+        log_write_string("Local APIC not present\n");
+        return false;
+    }
+
+    uint64_t base = rdmsr(IA32_APIC_BASE_MSR);
+    wrmsr(IA32_APIC_BASE_MSR, base | IA32_APIC_BASE_ENABLE);
+    lapic_base = (volatile uint32_t*)(uint32_t)(base & 0xFFFFF000);
+    if (!lapic_base) {
+        lapic_base = (volatile uint32_t*)LAPIC_DEFAULT_BASE;
+    }
+
+    // Software-enable the APIC; LINT0 stays in virtual wire mode for the PIC
+    idt_register_handler(LAPIC_SPURIOUS_VECTOR, lapic_spurious_handler);
+    lapic_write(LAPIC_REG_SVR, SVR_APIC_ENABLE | LAPIC_SPURIOUS_VECTOR);
+
+    lapic_timer_calibrate();
+    if (ticks_per_ms == 0) {
+        log_write_string("Local APIC timer calibration failed\n");
+        return false;
+    }
+
+    log_write_string("Local APIC timer ticks/ms: ");
+    log_write_hex(ticks_per_ms);
+    log_write_string("\n");
+    return true;
+}
+
+void lapic_eoi(void) {
+    lapic_write(LAPIC_REG_EOI, 0);
+}
+
+uint32_t lapic_timer_ticks_per_ms(void) {
+    return ticks_per_ms;
+}
+
+// One-shot mode: the timer counts down once and raises a single interrupt
+void lapic_timer_oneshot(uint32_t ticks) {
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_REG_TIMER_INIT, ticks ? ticks : 1);
+}
+
+// An initial count of zero stops the timer
+void lapic_timer_stop(void) {
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+}
@@ -0,0 +1,32 @@
+#ifndef LAPIC_H
+#define LAPIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Local APIC base MSR and default physical address
+#define IA32_APIC_BASE_MSR    0x1B
+#define IA32_APIC_BASE_ENABLE 0x800
+#define LAPIC_DEFAULT_BASE    0xFEE00000
+
+// Local APIC register offsets
+#define LAPIC_REG_ID          0x020
+#define LAPIC_REG_EOI         0x0B0
+#define LAPIC_REG_SVR         0x0F0
+#define LAPIC_REG_LVT_TIMER   0x320
+#define LAPIC_REG_TIMER_INIT  0x380
+#define LAPIC_REG_TIMER_CUR   0x390
+#define LAPIC_REG_TIMER_DIV   0x3E0
+
+// Interrupt vectors owned by the local APIC
+#define LAPIC_TIMER_VECTOR    0x30
+#define LAPIC_SPURIOUS_VECTOR 0xFF
+
+// Local APIC functions
+bool lapic_init(void);
+void lapic_eoi(void);
+uint32_t lapic_timer_ticks_per_ms(void);
+void lapic_timer_oneshot(uint32_t ticks);
+void lapic_timer_stop(void);
+
+#endif // LAPIC_H
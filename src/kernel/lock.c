@@ -0,0 +1,124 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "lock.h"
+#include "cpu.h"
+#include "patch.h"
+#include "terminal.h"
+
+// Number of locks shown by lock_print_stats, the hottest first
+#define LOCKS_SHOWN 8
+
+DEFINE_STATIC_KEY(lock_stats_key, "lockstat");
+
+// Locks that have been acquired while statistics were on
+static struct lock_stats* registry = NULL;
+static spinlock_t registry_lock = SPINLOCK_INIT(NULL);
+
+static void lock_stat_register(struct lock_stats* stats) {
+    uint32_t flags = spin_lock_irqsave(&registry_lock);
+    if (!stats->registered) {
+        stats->next = registry;
+        registry = stats;
+        stats->registered = true;
+    }
+    spin_unlock_irqrestore(&registry_lock, flags);
+}
+
+// Called with the lock held
+void lock_stat_acquired(struct lock_stats* stats, uint32_t spins) {
+    if (!stats) {
+        return;
+    }
+
+    if (!stats->registered) {
+        lock_stat_register(stats);
+    }
+    stats->acquisitions++;
+    if (spins) {
+        stats->contended++;
+        stats->spins += spins;
+    }
+    stats->hold_start = rdtsc();
+}
+
+// Called with the lock still held. A lock taken before statistics were
+// switched on has no start time and is not counted.
+void lock_stat_released(struct lock_stats* stats) {
+    if (!stats || !stats->hold_start) {
+        return;
+    }
+
+    uint64_t held = rdtsc() - stats->hold_start;
+    if (held > stats->max_hold) {
+        stats->max_hold = held;
+    }
+    stats->hold_start = 0;
+}
+
+// Most time spent waiting first, then most acquisitions
+static bool lock_hotter(const struct lock_stats* a, const struct lock_stats* b) {
+    if (a->spins != b->spins) {
+        return a->spins > b->spins;
+    }
+    return a->acquisitions > b->acquisitions;
+}
+
+static void write_padded(const char* str, size_t width) {
+    size_t len = 0;
+    while (str[len]) {
+        len++;
+    }
+    terminal_writestring(str);
+    for (; len < width; len++) {
+        terminal_putchar(' ');
+    }
+}
+
+static void write_dec_padded(uint32_t value, size_t width) {
+    size_t len = 1;
+    for (uint32_t v = value; v >= 10; v /= 10) {
+        len++;
+    }
+    terminal_writedec(value);
+    for (; len < width; len++) {
+        terminal_putchar(' ');
+    }
+}
+
+void lock_print_stats(void) {
+    const struct lock_stats* hottest[LOCKS_SHOWN];
+    int count = 0;
+
+    // Keep the LOCKS_SHOWN hottest, sorted; printing happens after the
+    // registry lock is dropped since the terminal has a lock of its own
+    uint32_t flags = spin_lock_irqsave(&registry_lock);
+    for (const struct lock_stats* s = registry; s; s = s->next) {
+        int i = count < LOCKS_SHOWN ? count++ : LOCKS_SHOWN;
+        while (i > 0 && lock_hotter(s, hottest[i - 1])) {
+            if (i < LOCKS_SHOWN) {
+                hottest[i] = hottest[i - 1];
+            }
+            i--;
+        }
+        if (i < LOCKS_SHOWN) {
+            hottest[i] = s;
+        }
+    }
+    spin_unlock_irqrestore(&registry_lock, flags);
+
+    if (!static_key_enabled(&lock_stats_key)) {
+        terminal_writestring("Lock statistics are off, enable them with 'key lockstat'\n");
+    }
+    terminal_writestring("Lock          Acquired    Contended Spins       Max hold (cycles)\n");
+
+    for (int i = 0; i < count; i++) {
+        const struct lock_stats* s = hottest[i];
+        write_padded(s->name, 14);
+        write_dec_padded(s->acquisitions, 12);
+        write_dec_padded(s->contended, 10);
+        write_dec_padded(s->spins, 12);
+        terminal_writedec(s->max_hold > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)s->max_hold);
+        terminal_putchar('\n');
+    }
+}
@@ -0,0 +1,257 @@
+#ifndef LOCK_H
+#define LOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "cpu.h"
+#include "patch.h"
+
+// Locks.
+//
+// spinlock_t:  test-and-test-and-set; smallest and fastest uncontended.
+// ticket_lock_t: FIFO order, so no waiter starves under contention.
+// mcs_lock_t:  FIFO queue where each waiter spins on its own node, so a
+//              contended lock does not bounce one cache line between CPUs.
+//
+// The _irqsave variants also disable interrupts. They are required for locks
+// that interrupt handlers take, or a handler could spin forever on a lock
+// held by the code it interrupted.
+//
+// Every lock may point at a struct lock_stats. Statistics are only
+// gathered while the "lockstat" static key is on, so they cost a NOP per
+// acquisition and release otherwise.
+
+struct lock_stats {
+    const char* name;
+    uint32_t acquisitions;
+    uint32_t contended;        // Acquisitions that had to wait
+    uint32_t spins;            // Wait loop iterations
+    uint64_t max_hold;         // Longest hold time in TSC cycles
+    uint64_t hold_start;
+    struct lock_stats* next;   // Registry of locks seen by lock_stat_acquired
+    bool registered;
+};
+
+#define LOCK_STATS_INIT(lock_name) { lock_name, 0, 0, 0, 0, 0, NULL, false }
+
+typedef struct spinlock {
+    volatile uint32_t locked;
+    struct lock_stats* stats;
+} spinlock_t;
+
+typedef struct ticket_lock {
+    union {
+        volatile uint32_t word;
+        struct {
+            volatile uint16_t owner;   // Ticket being served
+            volatile uint16_t next;    // Next ticket to hand out
+        };
+    };
+    struct lock_stats* stats;
+} ticket_lock_t;
+
+// Queue entry of an MCS lock, owned by the waiter (usually on its stack)
+struct mcs_node {
+    struct mcs_node* volatile next;
+    volatile uint32_t locked;
+};
+
+typedef struct mcs_lock {
+    struct mcs_node* volatile tail;
+    struct lock_stats* stats;
+} mcs_lock_t;
+
+#define SPINLOCK_INIT(stats_ptr)    { 0, stats_ptr }
+#define TICKET_LOCK_INIT(stats_ptr) { { 0 }, stats_ptr }
+#define MCS_LOCK_INIT(stats_ptr)    { NULL, stats_ptr }
+
+// File-local lock with statistics under the given name
+#define DEFINE_SPINLOCK(var, lock_name) \
+    static struct lock_stats var##_stats = LOCK_STATS_INIT(lock_name); \
+    static spinlock_t var = SPINLOCK_INIT(&var##_stats)
+
+#define DEFINE_TICKET_LOCK(var, lock_name) \
+    static struct lock_stats var##_stats = LOCK_STATS_INIT(lock_name); \
+    static ticket_lock_t var = TICKET_LOCK_INIT(&var##_stats)
+
+#define DEFINE_MCS_LOCK(var, lock_name) \
+    static struct lock_stats var##_stats = LOCK_STATS_INIT(lock_name); \
+    static mcs_lock_t var = MCS_LOCK_INIT(&var##_stats)
+
+DECLARE_STATIC_KEY(lock_stats_key);
+
+// Lock functions
+void lock_stat_acquired(struct lock_stats* stats, uint32_t spins);
+void lock_stat_released(struct lock_stats* stats);
+void lock_print_stats(void);
+
+// Atomic primitives (lock-prefixed, so usable on every CPU from the 486 on)
+static inline uint32_t atomic_xchg(volatile uint32_t* ptr, uint32_t value) {
+    __asm__ volatile("xchgl %0, %1" : "+r"(value), "+m"(*ptr) : : "memory");
+    return value;
+}
+
+static inline uint32_t atomic_fetch_add(volatile uint32_t* ptr, uint32_t value) {
+    __asm__ volatile("lock; xaddl %0, %1" : "+r"(value), "+m"(*ptr) : : "memory");
+    return value;
+}
+
+static inline bool atomic_cmpxchg(volatile uint32_t* ptr, uint32_t old, uint32_t value) {
+    uint32_t prev = old;
+    __asm__ volatile("lock; cmpxchgl %2, %1" : "+a"(prev), "+m"(*ptr) : "r"(value) : "memory");
+    return prev == old;
+}
+
+static inline struct mcs_node* atomic_xchg_node(struct mcs_node* volatile* ptr, struct mcs_node* value) {
+    __asm__ volatile("xchg %0, %1" : "+r"(value), "+m"(*ptr) : : "memory");
+    return value;
+}
+
+static inline bool atomic_cmpxchg_node(struct mcs_node* volatile* ptr, struct mcs_node* old,
+                                       struct mcs_node* value) {
+    struct mcs_node* prev = old;
+    __asm__ volatile("lock; cmpxchg %2, %1" : "+a"(prev), "+m"(*ptr) : "r"(value) : "memory");
+    return prev == old;
+}
+
+static inline void lock_acquired(struct lock_stats* stats, uint32_t spins) {
+    if (static_branch(&lock_stats_key)) {
+        lock_stat_acquired(stats, spins);
+    }
+}
+
+static inline void lock_released(struct lock_stats* stats) {
+    if (static_branch(&lock_stats_key)) {
+        lock_stat_released(stats);
+    }
+}
+
+// Spinlock
+static inline void spin_lock(spinlock_t* lock) {
+    uint32_t spins = 0;
+
+    while (atomic_xchg(&lock->locked, 1)) {
+        while (lock->locked) {
+            cpu_relax();
+            spins++;
+        }
+    }
+    lock_acquired(lock->stats, spins);
+}
+
+static inline bool spin_trylock(spinlock_t* lock) {
+    if (lock->locked || atomic_xchg(&lock->locked, 1)) {
+        return false;
+    }
+    lock_acquired(lock->stats, 0);
+    return true;
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+    lock_released(lock->stats);
+    __asm__ volatile("" ::: "memory");
+    lock->locked = 0;
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock) {
+    uint32_t flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags) {
+    spin_unlock(lock);
+    irq_restore(flags);
+}
+
+// Ticket lock
+static inline void ticket_lock(ticket_lock_t* lock) {
+    uint16_t ticket = (uint16_t)(atomic_fetch_add(&lock->word, 1u << 16) >> 16);
+    uint32_t spins = 0;
+
+    while (lock->owner != ticket) {
+        cpu_relax();
+        spins++;
+    }
+    __asm__ volatile("" ::: "memory");
+    lock_acquired(lock->stats, spins);
+}
+
+// Takes a ticket only if it would be served at once
+static inline bool ticket_trylock(ticket_lock_t* lock) {
+    uint32_t word = lock->word;
+
+    if ((word & 0xFFFF) != (word >> 16) || !atomic_cmpxchg(&lock->word, word, word + (1u << 16))) {
+        return false;
+    }
+    __asm__ volatile("" ::: "memory");
+    lock_acquired(lock->stats, 0);
+    return true;
+}
+
+// Only the holder writes owner, so a plain store is enough
+static inline void ticket_unlock(ticket_lock_t* lock) {
+    lock_released(lock->stats);
+    __asm__ volatile("" ::: "memory");
+    lock->owner = (uint16_t)(lock->owner + 1);
+}
+
+static inline uint32_t ticket_lock_irqsave(ticket_lock_t* lock) {
+    uint32_t flags = irq_save();
+    ticket_lock(lock);
+    return flags;
+}
+
+static inline void ticket_unlock_irqrestore(ticket_lock_t* lock, uint32_t flags) {
+    ticket_unlock(lock);
+    irq_restore(flags);
+}
+
+// MCS lock
+static inline void mcs_lock(mcs_lock_t* lock, struct mcs_node* node) {
+    uint32_t spins = 0;
+
+    node->next = NULL;
+    node->locked = 1;
+
+    struct mcs_node* prev = atomic_xchg_node(&lock->tail, node);
+    if (prev) {
+        prev->next = node;
+        while (node->locked) {
+            cpu_relax();
+            spins++;
+        }
+    }
+    __asm__ volatile("" ::: "memory");
+    lock_acquired(lock->stats, spins);
+}
+
+static inline void mcs_unlock(mcs_lock_t* lock, struct mcs_node* node) {
+    lock_released(lock->stats);
+    __asm__ volatile("" ::: "memory");
+
+    if (!node->next) {
+        if (atomic_cmpxchg_node(&lock->tail, node, NULL)) {
+            return;
+        }
+        // A waiter swapped itself in but has not linked to us yet
+        while (!node->next) {
+            cpu_relax();
+        }
+    }
+    node->next->locked = 0;
+}
+
+static inline uint32_t mcs_lock_irqsave(mcs_lock_t* lock, struct mcs_node* node) {
+    uint32_t flags = irq_save();
+    mcs_lock(lock, node);
+    return flags;
+}
+
+static inline void mcs_unlock_irqrestore(mcs_lock_t* lock, struct mcs_node* node, uint32_t flags) {
+    mcs_unlock(lock, node);
+    irq_restore(flags);
+}
+
+#endif // LOCK_H
@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "log.h"
+#include "uart.h"
+#include "lock.h"
+
+static void uart_sink(const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uart_write_char(data[i]);
+    }
+}
+
+// Indexed by sink bit number; the UART is always available
+static log_sink_fn_t sinks[LOG_SINK_COUNT] = { uart_sink, NULL };
+static uint32_t enabled_sinks = LOG_SINK_UART;
+
+void log_register_sink(uint32_t sink, log_sink_fn_t fn) {
+    for (int i = 0; i < LOG_SINK_COUNT; i++) {
+        if (sink == (1u << i)) {
+            sinks[i] = fn;
+        }
+    }
+}
+
+// Fails, leaving the sinks as they were, if any of them has no driver
+bool log_set_sinks(uint32_t mask) {
+    uint32_t available = 0;
+    for (int i = 0; i < LOG_SINK_COUNT; i++) {
+        if (sinks[i]) {
+            available |= 1u << i;
+        }
+    }
+    if (mask == 0 || (mask & ~available)) {
+        return false;
+    }
+    enabled_sinks = mask;
+    return true;
+}
+
+uint32_t log_get_sinks(void) {
+    return enabled_sinks;
+}
+
+// Every CPU and interrupt handler logs through here, so it gets a queue
+// lock: waiters spin on their own node instead of the lock word
+DEFINE_MCS_LOCK(log_lock, "log");
+
+// Write to the given sinks whether or not they are enabled, in order with
+// all other log output
+void log_write_to(uint32_t mask, const char* data, size_t len) {
+    struct mcs_node node;
+    uint32_t flags = mcs_lock_irqsave(&log_lock, &node);
+
+    for (int i = 0; i < LOG_SINK_COUNT; i++) {
+        if ((mask & (1u << i)) && sinks[i]) {
+            sinks[i](data, len);
+        }
+    }
+
+    mcs_unlock_irqrestore(&log_lock, &node, flags);
+}
+
+void log_write(const char* data, size_t len) {
+    log_write_to(enabled_sinks, data, len);
+}
+
+void log_write_string(const char* str) {
+    size_t len = 0;
+    while (str[len]) {
+        len++;
+    }
+    log_write(str, len);
+}
+
+void log_write_hex(uint32_t value) {
+    const char hex_chars[] = "0123456789ABCDEF";
+    char hex_str[10];
+    hex_str[0] = '0';
+    hex_str[1] = 'x';
+
+    for (int i = 0; i < 8; i++) {
+        hex_str[9 - i] = hex_chars[(value >> (i * 4)) & 0xF];
+    }
+
+    log_write(hex_str, sizeof(hex_str));
+}
+
+void log_write_dec(uint32_t value) {
+    char dec_str[10];
+    int i = sizeof(dec_str);
+
+    do {
+        dec_str[--i] = '0' + (value % 10);
+        value /= 10;
+    } while (value);
+
+    log_write(&dec_str[i], sizeof(dec_str) - i);
+}
@@ -0,0 +1,25 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Log output sinks, usable as a bit mask
+#define LOG_SINK_UART   (1 << 0)
+#define LOG_SINK_VIRTIO (1 << 1)
+#define LOG_SINK_COUNT  2
+
+typedef void (*log_sink_fn_t)(const char* data, size_t len);
+
+// Log functions
+void log_register_sink(uint32_t sink, log_sink_fn_t fn);
+bool log_set_sinks(uint32_t mask);
+uint32_t log_get_sinks(void);
+void log_write(const char* data, size_t len);
+void log_write_to(uint32_t mask, const char* data, size_t len);
+void log_write_string(const char* str);
+void log_write_hex(uint32_t value);
+void log_write_dec(uint32_t value);
+
+#endif // LOG_H
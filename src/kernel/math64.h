@@ -0,0 +1,36 @@
+#ifndef MATH64_H
+#define MATH64_H
+
+#include <stdint.h>
+
+// 64-bit helpers for i386: we link without libgcc, so plain 64-bit '/' and '%'
+// (which compile to __udivdi3/__umoddi3 calls) are not available.
+
+// Divide a 64-bit value by a 32-bit one using two divl steps
+static inline uint64_t div_u64_u32(uint64_t dividend, uint32_t divisor, uint32_t* remainder) {
+    uint32_t high = (uint32_t)(dividend >> 32);
+    uint32_t low = (uint32_t)dividend;
+    uint32_t q_high = high / divisor;
+    uint32_t rem = high % divisor;
+    uint32_t q_low;
+
+    __asm__("divl %4" : "=a"(q_low), "=d"(rem) : "a"(low), "d"(rem), "rm"(divisor));
+
+    if (remainder) {
+        *remainder = rem;
+    }
+    return ((uint64_t)q_high << 32) | q_low;
+}
+
+// (value * mult) >> shift without losing the upper bits of the 96-bit product
+static inline uint64_t mul_u64_u32_shr(uint64_t value, uint32_t mult, unsigned int shift) {
+    uint64_t low = (uint64_t)(uint32_t)value * mult;
+    uint64_t high = (uint64_t)(uint32_t)(value >> 32) * mult;
+
+    if (shift >= 32) {
+        return (high + (low >> 32)) >> (shift - 32);
+    }
+    return (low >> shift) + (high << (32 - shift));
+}
+
+#endif // MATH64_H
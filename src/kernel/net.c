@@ -0,0 +1,172 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "net.h"
+#include "e1000.h"
+#include "timer.h"
+#include "terminal.h"
+#include "math64.h"
+
+// Minimal Ethernet/ARP/IPv4/UDP responder. Replies are built by rewriting the
+// received frame in place, so no packet is ever allocated or copied.
+
+static uint8_t mac_address[6];
+
+static uint32_t arp_replies = 0;
+static uint32_t udp_echoes = 0;
+
+// Snapshot for rate computation in 'net stats'
+static uint32_t last_stats_ms = 0;
+static uint32_t last_rx_packets = 0;
+static uint32_t last_tx_packets = 0;
+
+static void copy_mac(uint8_t* dst, const uint8_t* src) {
+    for (int i = 0; i < 6; i++) {
+        dst[i] = src[i];
+    }
+}
+
+static uint16_t ip_checksum(const void* data, size_t len) {
+    const uint16_t* words = (const uint16_t*)data;
+    uint32_t sum = 0;
+
+    for (size_t i = 0; i < len / 2; i++) {
+        sum += words[i];
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+// Address the reply back to the sender of the frame
+static void eth_reply(struct eth_header* eth) {
+    copy_mac(eth->dst, eth->src);
+    copy_mac(eth->src, mac_address);
+}
+
+static bool arp_receive(struct eth_header* eth, uint16_t len) {
+    struct arp_packet* arp = (struct arp_packet*)(eth + 1);
+
+    if (len < sizeof(*eth) + sizeof(*arp) || ntohs(arp->oper) != 1 || arp->tpa != NET_IP_ADDR) {
+        return false;
+    }
+
+    arp->oper = htons(2);
+    copy_mac(arp->tha, arp->sha);
+    arp->tpa = arp->spa;
+    copy_mac(arp->sha, mac_address);
+    arp->spa = NET_IP_ADDR;
+    eth_reply(eth);
+
+    arp_replies++;
+    return true;
+}
+
+static bool ipv4_receive(struct eth_header* eth, uint16_t* len) {
+    struct ipv4_header* ip = (struct ipv4_header*)(eth + 1);
+
+    if (*len < sizeof(*eth) + sizeof(*ip) || ip->version_ihl != 0x45 ||
+        ip->dst != NET_IP_ADDR || ip->protocol != IP_PROTO_UDP ||
+        (ntohs(ip->fragment) & 0x3FFF)) {
+        return false;
+    }
+
+    uint16_t ip_len = ntohs(ip->total_length);
+    if (ip_len < sizeof(*ip) + sizeof(struct udp_header) || sizeof(*eth) + ip_len > *len) {
+        return false;
+    }
+
+    struct udp_header* udp = (struct udp_header*)(ip + 1);
+    if (ntohs(udp->dst_port) != NET_UDP_ECHO_PORT) {
+        return false;
+    }
+
+    // Swapping addresses and ports keeps the UDP checksum valid
+    uint32_t addr = ip->src;
+    ip->src = ip->dst;
+    ip->dst = addr;
+    uint16_t port = udp->src_port;
+    udp->src_port = udp->dst_port;
+    udp->dst_port = port;
+
+    ip->ttl = 64;
+    ip->checksum = 0;
+    ip->checksum = ip_checksum(ip, sizeof(*ip));
+    eth_reply(eth);
+
+    // Drop Ethernet padding from the reply
+    *len = sizeof(*eth) + ip_len;
+    udp_echoes++;
+    return true;
+}
+
+static bool net_receive(uint8_t* frame, uint16_t* len) {
+    struct eth_header* eth = (struct eth_header*)frame;
+
+    if (*len < sizeof(*eth)) {
+        return false;
+    }
+
+    switch (ntohs(eth->type)) {
+    case ETH_TYPE_ARP:
+        return arp_receive(eth, *len);
+    case ETH_TYPE_IPV4:
+        return ipv4_receive(eth, len);
+    default:
+        return false;
+    }
+}
+
+bool net_init(void) {
+    if (!e1000_init(net_receive)) {
+        return false;
+    }
+
+    e1000_get_mac(mac_address);
+    last_stats_ms = timer_now();
+    return true;
+}
+
+static uint32_t per_second(uint32_t count, uint32_t elapsed_ms) {
+    return (uint32_t)div_u64_u32((uint64_t)count * 1000, elapsed_ms, NULL);
+}
+
+static void print_stat(const char* name, uint32_t value) {
+    terminal_writestring(name);
+    terminal_writedec(value);
+    terminal_writestring("\n");
+}
+
+void net_print_stats(void) {
+    if (!e1000_present()) {
+        terminal_writestring("No network device\n");
+        return;
+    }
+
+    struct e1000_stats stats;
+    e1000_get_stats(&stats);
+
+    uint32_t now = timer_now();
+    uint32_t elapsed = now - last_stats_ms;
+    if (elapsed == 0) {
+        elapsed = 1;
+    }
+
+    print_stat("rx packets:      ", stats.rx_packets);
+    print_stat("tx packets:      ", stats.tx_packets);
+    print_stat("rx pps:          ", per_second(stats.rx_packets - last_rx_packets, elapsed));
+    print_stat("tx pps:          ", per_second(stats.tx_packets - last_tx_packets, elapsed));
+    print_stat("rx dropped:      ", stats.rx_dropped);
+    print_stat("tx dropped:      ", stats.tx_dropped);
+    print_stat("arp replies:     ", arp_replies);
+    print_stat("udp echoes:      ", udp_echoes);
+    print_stat("interrupts:      ", stats.interrupts);
+    print_stat("polls:           ", stats.polls);
+    print_stat("rx ring pending: ", e1000_rx_ring_used());
+    print_stat("tx ring in use:  ", e1000_tx_ring_used());
+
+    last_stats_ms = now;
+    last_rx_packets = stats.rx_packets;
+    last_tx_packets = stats.tx_packets;
+}
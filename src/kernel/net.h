@@ -0,0 +1,70 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// IPv4 address in network byte order as stored in a packet
+#define NET_IP(a, b, c, d) \
+    ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+// Guest address on QEMU's user-mode network
+#define NET_IP_ADDR NET_IP(10, 0, 2, 15)
+#define NET_UDP_ECHO_PORT 7
+
+#define ETH_TYPE_IPV4 0x0800
+#define ETH_TYPE_ARP  0x0806
+#define IP_PROTO_UDP  17
+
+struct eth_header {
+    uint8_t dst[6];
+    uint8_t src[6];
+    uint16_t type;
+} __attribute__((packed));
+
+struct arp_packet {
+    uint16_t htype;
+    uint16_t ptype;
+    uint8_t hlen;
+    uint8_t plen;
+    uint16_t oper;
+    uint8_t sha[6];
+    uint32_t spa;
+    uint8_t tha[6];
+    uint32_t tpa;
+} __attribute__((packed));
+
+struct ipv4_header {
+    uint8_t version_ihl;
+    uint8_t tos;
+    uint16_t total_length;
+    uint16_t id;
+    uint16_t fragment;
+    uint8_t ttl;
+    uint8_t protocol;
+    uint16_t checksum;
+    uint32_t src;
+    uint32_t dst;
+} __attribute__((packed));
+
+struct udp_header {
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint16_t length;
+    uint16_t checksum;
+} __attribute__((packed));
+
+// Byte order helpers
+static inline uint16_t htons(uint16_t value) {
+    return (uint16_t)((value << 8) | (value >> 8));
+}
+
+static inline uint16_t ntohs(uint16_t value) {
+    return htons(value);
+}
+
+// Net functions
+bool net_init(void);
+void net_print_stats(void);
+
+#endif // NET_H
@@ -0,0 +1,256 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "paging.h"
+#include "cpu.h"
+#include "log.h"
+
+// Page directory and page table entry bits
+#define PTE_PRESENT 0x001
+#define PTE_WRITE   0x002
+#define PTE_PWT     0x008
+#define PTE_PCD     0x010
+#define PDE_LARGE   0x080   // Maps a 4 MiB page
+
+#define CR0_PG  0x80000000
+#define CR4_PSE 0x00000010
+
+#define IA32_MTRRCAP_MSR        0xFE
+#define IA32_MTRR_FIX16K_A0000  0x259
+#define IA32_PAT_MSR            0x277
+#define IA32_MTRR_DEF_TYPE_MSR  0x2FF
+
+#define MTRRCAP_FIXED           0x100
+#define MTRR_DEF_TYPE_FIXED     0x400
+#define MTRR_DEF_TYPE_ENABLE    0x800
+
+// Memory type encodings shared by the PAT and the MTRRs
+#define MTYPE_UC       0x00
+#define MTYPE_WC       0x01
+#define MTYPE_WT       0x04
+#define MTYPE_WP       0x05
+#define MTYPE_WB       0x06
+#define MTYPE_UC_MINUS 0x07
+
+// An entry's PWT, PCD and PAT bits select one of the eight PAT entries.
+// Entry 1 (PWT alone) becomes write-combining in place of write-through;
+// the others keep their power-on types, so PCD|PWT is still uncached and a
+// CPU with the PAT ignored behaves as before for everything but WC pages.
+#define PAT_ENTRY(n, type) ((uint64_t)(type) << ((n) * 8))
+#define PAT_VALUE (PAT_ENTRY(0, MTYPE_WB) | PAT_ENTRY(1, MTYPE_WC) | \
+                   PAT_ENTRY(2, MTYPE_UC_MINUS) | PAT_ENTRY(3, MTYPE_UC) | \
+                   PAT_ENTRY(4, MTYPE_WB) | PAT_ENTRY(5, MTYPE_WC) | \
+                   PAT_ENTRY(6, MTYPE_UC_MINUS) | PAT_ENTRY(7, MTYPE_UC))
+
+#define LEGACY_VGA_BASE 0xA0000
+#define TEXT_VGA_BASE   0xB8000
+
+// 4 MiB pages split so that part of one can have another type
+#define SPLIT_TABLES 4
+
+static uint32_t page_directory[1024] __attribute__((aligned(PAGE_SIZE)));
+static uint32_t low_page_table[1024] __attribute__((aligned(PAGE_SIZE)));
+static uint32_t split_tables[SPLIT_TABLES][1024] __attribute__((aligned(PAGE_SIZE)));
+static int split_tables_used = 0;
+static bool paging_on = false;
+
+static inline uint32_t read_cr0(void) {
+    uint32_t value;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+static inline void write_cr0(uint32_t value) {
+    __asm__ volatile("mov %0, %%cr0" : : "r"(value) : "memory");
+}
+
+static inline void write_cr3(uint32_t value) {
+    __asm__ volatile("mov %0, %%cr3" : : "r"(value) : "memory");
+}
+
+static inline uint32_t read_cr4(void) {
+    uint32_t value;
+    __asm__ volatile("mov %%cr4, %0" : "=r"(value));
+    return value;
+}
+
+static inline void write_cr4(uint32_t value) {
+    __asm__ volatile("mov %0, %%cr4" : : "r"(value) : "memory");
+}
+
+static inline void invlpg(uint32_t address) {
+    __asm__ volatile("invlpg (%0)" : : "r"(address) : "memory");
+}
+
+static inline void wbinvd(void) {
+    __asm__ volatile("wbinvd" ::: "memory");
+}
+
+static uint32_t type_bits(enum mem_type type) {
+    switch (type) {
+    case MEM_WC:
+        return PTE_PWT;
+    case MEM_UC:
+        return PTE_PCD | PTE_PWT;
+    default:
+        return 0;
+    }
+}
+
+static const char* mtype_name(uint8_t type) {
+    switch (type) {
+    case MTYPE_UC: return "UC";
+    case MTYPE_WC: return "WC";
+    case MTYPE_WT: return "WT";
+    case MTYPE_WP: return "WP";
+    case MTYPE_WB: return "WB";
+    default:       return "?";
+    }
+}
+
+// The type the MTRRs give the VGA text buffer, which is what it had with
+// paging off. A WC page overrides every MTRR type, so this is informational.
+static void mtrr_report(void) {
+    log_write_string("Paging: VGA text memory was ");
+
+    if (!cpu_has_edx_feature(CPUID_EDX_MTRR)) {
+        log_write_string("uncached (no MTRRs)\n");
+        return;
+    }
+
+    uint32_t def_type = (uint32_t)rdmsr(IA32_MTRR_DEF_TYPE_MSR);
+    uint32_t cap = (uint32_t)rdmsr(IA32_MTRRCAP_MSR);
+    uint8_t type = MTYPE_UC;
+
+    if ((def_type & MTRR_DEF_TYPE_ENABLE) && (def_type & MTRR_DEF_TYPE_FIXED) &&
+        (cap & MTRRCAP_FIXED)) {
+        // Eight 16 KiB ranges from 0xA0000, one type byte each
+        uint64_t types = rdmsr(IA32_MTRR_FIX16K_A0000);
+        type = (uint8_t)(types >> ((TEXT_VGA_BASE - LEGACY_VGA_BASE) / 0x4000 * 8));
+    } else if (def_type & MTRR_DEF_TYPE_ENABLE) {
+        type = (uint8_t)def_type;
+    }
+    log_write_string(mtype_name(type));
+    log_write_string(" by MTRR\n");
+}
+
+// Whether the directory entry for addr maps a 4 MiB page (or nothing yet)
+static bool pde_is_large(uint32_t addr) {
+    uint32_t pde = page_directory[addr / LARGE_PAGE_SIZE];
+    return !(pde & PTE_PRESENT) || (pde & PDE_LARGE);
+}
+
+// 4 MiB pages that [base, last] covers only part of and that are not split
+// yet; only the first and the last page of a region can be one
+static int splits_needed(uint32_t base, uint32_t last) {
+    uint32_t first_page = base & ~(LARGE_PAGE_SIZE - 1);
+    uint32_t last_page = last & ~(LARGE_PAGE_SIZE - 1);
+    int needed = 0;
+
+    if (pde_is_large(first_page) &&
+        (base != first_page || last - first_page < LARGE_PAGE_SIZE - 1)) {
+        needed++;
+    }
+    if (last_page != first_page && pde_is_large(last_page) &&
+        last - last_page < LARGE_PAGE_SIZE - 1) {
+        needed++;
+    }
+    return needed;
+}
+
+// Page table for the 4 MiB at addr. A 4 MiB page is split into 4 KiB pages
+// of the same type first; splits_needed() made sure a table is left.
+static uint32_t* page_table_for(uint32_t addr, bool flush) {
+    uint32_t* pde = &page_directory[addr / LARGE_PAGE_SIZE];
+
+    if (!(*pde & PDE_LARGE)) {
+        return (uint32_t*)(*pde & ~(PAGE_SIZE - 1));
+    }
+
+    uint32_t* table = split_tables[split_tables_used++];
+    uint32_t start = *pde & ~(LARGE_PAGE_SIZE - 1);
+    uint32_t bits = *pde & (PTE_PCD | PTE_PWT);
+
+    for (int i = 0; i < 1024; i++) {
+        table[i] = (start + i * PAGE_SIZE) | PTE_PRESENT | PTE_WRITE | bits;
+    }
+    *pde = (uint32_t)table | PTE_PRESENT | PTE_WRITE;
+    if (flush) {
+        invlpg(start);
+    }
+    return table;
+}
+
+// Point every entry covering [base, last] at the type: whole 4 MiB pages
+// where the region covers them, 4 KiB pages everywhere else, so no memory
+// outside the region changes type
+static void set_entries(uint32_t base, uint32_t last, uint32_t bits, bool flush) {
+    uint32_t addr = base & ~(PAGE_SIZE - 1);
+
+    while (addr <= last) {
+        uint32_t next;
+        if ((addr & (LARGE_PAGE_SIZE - 1)) == 0 && last - addr >= LARGE_PAGE_SIZE - 1 &&
+            pde_is_large(addr)) {
+            page_directory[addr / LARGE_PAGE_SIZE] = addr | PTE_PRESENT | PTE_WRITE | PDE_LARGE | bits;
+            next = addr + LARGE_PAGE_SIZE;
+        } else {
+            uint32_t* table = page_table_for(addr, flush);
+            table[(addr / PAGE_SIZE) % 1024] = addr | PTE_PRESENT | PTE_WRITE | bits;
+            next = addr + PAGE_SIZE;
+        }
+        if (flush) {
+            invlpg(addr);
+        }
+        if (next == 0) {
+            break;  // Wrapped past 4 GiB
+        }
+        addr = next;
+    }
+}
+
+bool paging_init(void) {
+    if (!cpu_has_edx_feature(CPUID_EDX_PSE) || !cpu_has_edx_feature(CPUID_EDX_PAT)) {
+        log_write_string("Paging: no PSE or PAT, staying off; video memory is uncached\n");
+        return false;
+    }
+
+    mtrr_report();
+    wrmsr(IA32_PAT_MSR, PAT_VALUE);
+
+    page_directory[0] = (uint32_t)low_page_table | PTE_PRESENT | PTE_WRITE;
+    set_entries(0, 0xFFFFFFFF, 0, false);
+
+    write_cr4(read_cr4() | CR4_PSE);
+    write_cr3((uint32_t)page_directory);
+    write_cr0(read_cr0() | CR0_PG);
+    paging_on = true;
+
+    log_write_string("Paging: 4 GiB identity mapped, PAT entry 1 is write-combining\n");
+    return true;
+}
+
+bool paging_enabled(void) {
+    return paging_on;
+}
+
+// Changing the type of a mapping needs the old translations and any lines
+// cached under the old type gone before the new one is used
+bool paging_set_type(uint32_t base, uint32_t size, enum mem_type type) {
+    if (!paging_on || size == 0) {
+        return false;
+    }
+
+    uint32_t last = size - 1 > 0xFFFFFFFF - base ? 0xFFFFFFFF : base + (size - 1);
+    if (splits_needed(base, last) > SPLIT_TABLES - split_tables_used) {
+        log_write_string("Paging: no page table left to split for ");
+        log_write_hex(base);
+        log_write_string(", type left unchanged\n");
+        return false;
+    }
+
+    uint32_t flags = irq_save();
+    cpu_wc_flush();
+    set_entries(base, last, type_bits(type), true);
+    wbinvd();
+    irq_restore(flags);
+    return true;
+}
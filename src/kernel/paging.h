@@ -0,0 +1,32 @@
+#ifndef PAGING_H
+#define PAGING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Identity-mapped paging, there only to give memory regions a cache type
+// through the Page Attribute Table.
+//
+// All of the 32-bit address space is mapped 1:1 and writable. Pages are
+// write-back by default, which leaves the type to the MTRRs exactly as with
+// paging off; paging_set_type() overrides it for a region, e.g. to make
+// video memory write-combining. The first 4 MiB uses 4 KiB pages so the
+// VGA text buffer can have its own type, the rest 4 MiB pages; one of those
+// is split into 4 KiB pages when a region covers only part of it, so a type
+// never spills onto neighbouring memory.
+
+#define PAGE_SIZE       0x1000
+#define LARGE_PAGE_SIZE 0x400000
+
+enum mem_type {
+    MEM_WB,     // Write-back, or whatever the MTRRs say
+    MEM_WC,     // Write-combining
+    MEM_UC,     // Uncached
+};
+
+// Paging functions
+bool paging_init(void);
+bool paging_enabled(void);
+bool paging_set_type(uint32_t base, uint32_t size, enum mem_type type);
+
+#endif // PAGING_H
@@ -0,0 +1,154 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "patch.h"
+#include "cpu.h"
+#include "log.h"
+#include "terminal.h"
+
+#define JUMP_SITE_SIZE 5
+#define OPCODE_JMP_REL32 0xE9
+#define OPCODE_NOP 0x90
+
+static const uint8_t nop5[JUMP_SITE_SIZE] = { 0x0F, 0x1F, 0x44, 0x00, 0x00 };
+
+// Tables collected by the linker script
+extern struct jump_entry __jump_table_start[], __jump_table_end[];
+extern struct static_key __static_keys_start[], __static_keys_end[];
+extern struct alt_entry __altinstructions_start[], __altinstructions_end[];
+
+// Kernel text is identity mapped and writable, so it is patched in place.
+// Interrupts are kept off so no handler can run a half-written site; a CPU
+// notices stores to code it is about to execute, so no further
+// synchronisation is needed with a single CPU.
+static void text_poke(uint32_t address, const uint8_t* bytes, size_t len) {
+    volatile uint8_t* code = (volatile uint8_t*)address;
+    uint32_t flags = irq_save();
+
+    for (size_t i = 0; i < len; i++) {
+        code[i] = bytes[i];
+    }
+
+    irq_restore(flags);
+}
+
+static void jump_site_patch(const struct jump_entry* entry, bool enabled) {
+    uint8_t insn[JUMP_SITE_SIZE];
+
+    if (enabled) {
+        uint32_t rel = entry->target - (entry->code + JUMP_SITE_SIZE);
+        insn[0] = OPCODE_JMP_REL32;
+        insn[1] = rel & 0xFF;
+        insn[2] = (rel >> 8) & 0xFF;
+        insn[3] = (rel >> 16) & 0xFF;
+        insn[4] = (rel >> 24) & 0xFF;
+    } else {
+        for (int i = 0; i < JUMP_SITE_SIZE; i++) {
+            insn[i] = nop5[i];
+        }
+    }
+    text_poke(entry->code, insn, JUMP_SITE_SIZE);
+}
+
+static void static_key_set(struct static_key* key, bool enabled) {
+    if (key->enabled == enabled) {
+        return;
+    }
+
+    key->enabled = enabled;
+    for (struct jump_entry* entry = __jump_table_start; entry < __jump_table_end; entry++) {
+        if (entry->key == key) {
+            jump_site_patch(entry, enabled);
+        }
+    }
+}
+
+void static_key_enable(struct static_key* key) {
+    static_key_set(key, true);
+}
+
+void static_key_disable(struct static_key* key) {
+    static_key_set(key, false);
+}
+
+struct static_key* static_key_find(const char* name) {
+    for (struct static_key* key = __static_keys_start; key < __static_keys_end; key++) {
+        const char* a = key->name;
+        const char* b = name;
+        while (*a && *a == *b) {
+            a++;
+            b++;
+        }
+        if (*a == *b) {
+            return key;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t static_key_sites(const struct static_key* key) {
+    uint32_t sites = 0;
+    for (struct jump_entry* entry = __jump_table_start; entry < __jump_table_end; entry++) {
+        if (entry->key == key) {
+            sites++;
+        }
+    }
+    return sites;
+}
+
+void static_key_print(void) {
+    terminal_writestring("Key        State  Sites\n");
+    for (struct static_key* key = __static_keys_start; key < __static_keys_end; key++) {
+        size_t len = 0;
+        terminal_writestring(key->name);
+        while (key->name[len]) {
+            len++;
+        }
+        for (; len < 11; len++) {
+            terminal_putchar(' ');
+        }
+        terminal_writestring(key->enabled ? "on     " : "off    ");
+        terminal_writedec(static_key_sites(key));
+        terminal_putchar('\n');
+    }
+}
+
+// Swap in the replacement of every alternative the CPU supports. Original
+// sequences are at least as long as their replacement; the rest is padded
+// with single-byte NOPs.
+static uint32_t alternatives_apply(void) {
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t applied = 0;
+
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+
+    for (struct alt_entry* alt = __altinstructions_start; alt < __altinstructions_end; alt++) {
+        if (!(edx & (1u << alt->feature))) {
+            continue;
+        }
+
+        uint8_t insn[16];
+        const uint8_t* repl = (const uint8_t*)alt->repl;
+        if (alt->orig_len > sizeof(insn) || alt->repl_len > alt->orig_len) {
+            continue;
+        }
+        for (int i = 0; i < alt->orig_len; i++) {
+            insn[i] = i < alt->repl_len ? repl[i] : OPCODE_NOP;
+        }
+        text_poke(alt->orig, insn, alt->orig_len);
+        applied++;
+    }
+    return applied;
+}
+
+void patch_init(void) {
+    uint32_t applied = alternatives_apply();
+
+    log_write_string("Code patching: ");
+    log_write_dec(applied);
+    log_write_string(" of ");
+    log_write_dec(__altinstructions_end - __altinstructions_start);
+    log_write_string(" alternatives applied, ");
+    log_write_dec(__jump_table_end - __jump_table_start);
+    log_write_string(" static branch sites\n");
+}
@@ -0,0 +1,91 @@
+#ifndef PATCH_H
+#define PATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Runtime code patching.
+//
+// Static keys: static_branch() compiles to a 5-byte NOP that falls through
+// to the "disabled" path and records its address, the "enabled" target and
+// the key in .jump_table. Enabling a key rewrites every one of its sites to
+// a JMP, so a disabled key costs a NOP and no memory access at all.
+//
+// Alternatives: ALTERNATIVE() emits the original instructions, padded with
+// NOPs to the length of the replacement, and records both in
+// .altinstructions. patch_init() swaps in the replacement once at boot if
+// the CPU has the CPUID feature.
+
+struct static_key {
+    const char* name;
+    bool enabled;
+};
+
+// Keys start disabled; they live in .static_keys so the shell can list them
+#define DEFINE_STATIC_KEY(var, key_name) \
+    struct static_key var __attribute__((section(".static_keys"), used, aligned(4))) = { key_name, false }
+
+#define DECLARE_STATIC_KEY(var) extern struct static_key var
+
+// Site record in .jump_table, one per static_branch() instance
+struct jump_entry {
+    uint32_t code;
+    uint32_t target;
+    struct static_key* key;
+};
+
+// Record in .altinstructions, one per ALTERNATIVE() instance
+struct alt_entry {
+    uint32_t orig;
+    uint32_t repl;
+    uint16_t feature;      // CPUID leaf 1 EDX bit number
+    uint8_t orig_len;
+    uint8_t repl_len;
+};
+
+#define PATCH_STR_(x) #x
+#define PATCH_STR(x) PATCH_STR_(x)
+
+// CPUID leaf 1 EDX bit numbers usable with ALTERNATIVE()
+#define FEATURE_EDX_SSE  25
+#define FEATURE_EDX_SSE2 26
+
+static inline __attribute__((always_inline)) bool static_branch(struct static_key* key) {
+    __asm__ goto("1: .byte 0x0f, 0x1f, 0x44, 0x00, 0x00\n\t"
+                 ".pushsection .jump_table, \"aw\"\n\t"
+                 ".balign 4\n\t"
+                 ".long 1b, %l[enabled], %c0\n\t"
+                 ".popsection"
+                 : : "i"(key) : : enabled);
+    return false;
+enabled:
+    return true;
+}
+
+static inline bool static_key_enabled(const struct static_key* key) {
+    return key->enabled;
+}
+
+// Use as the template of an asm statement; feature must be a literal
+#define ALTERNATIVE(oldinstr, newinstr, feature) \
+    "661:\n\t" oldinstr "\n662:\n\t" \
+    ".skip -(((665f-664f)-(662b-661b)) > 0) * ((665f-664f)-(662b-661b)), 0x90\n" \
+    "663:\n\t" \
+    ".pushsection .altinstructions, \"a\"\n\t" \
+    ".balign 4\n\t" \
+    ".long 661b, 664f\n\t" \
+    ".word " PATCH_STR(feature) "\n\t" \
+    ".byte 663b-661b, 665f-664f\n\t" \
+    ".popsection\n\t" \
+    ".pushsection .altinstr_replacement, \"ax\"\n" \
+    "664:\n\t" newinstr "\n665:\n\t" \
+    ".popsection\n"
+
+// Patch functions
+void patch_init(void);
+void static_key_enable(struct static_key* key);
+void static_key_disable(struct static_key* key);
+struct static_key* static_key_find(const char* name);
+void static_key_print(void);
+
+#endif // PATCH_H
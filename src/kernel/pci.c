@@ -0,0 +1,151 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "pci.h"
+#include "io.h"
+#include "log.h"
+#include "terminal.h"
+
+// Devices found during enumeration
+static struct pci_device devices[PCI_MAX_DEVICES];
+static size_t device_count = 0;
+
+static uint32_t pci_config_address(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset) {
+    return 0x80000000 | ((uint32_t)bus << 16) | ((uint32_t)slot << 11) |
+           ((uint32_t)function << 8) | (offset & 0xFC);
+}
+
+uint32_t pci_config_read32(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset) {
+    outl(PCI_CONFIG_ADDRESS, pci_config_address(bus, slot, function, offset));
+    return inl(PCI_CONFIG_DATA);
+}
+
+uint16_t pci_config_read16(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset) {
+    uint32_t value = pci_config_read32(bus, slot, function, offset);
+    return (uint16_t)(value >> ((offset & 2) * 8));
+}
+
+void pci_config_write32(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint32_t value) {
+    outl(PCI_CONFIG_ADDRESS, pci_config_address(bus, slot, function, offset));
+    outl(PCI_CONFIG_DATA, value);
+}
+
+void pci_config_write16(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint16_t value) {
+    uint32_t old = pci_config_read32(bus, slot, function, offset);
+    uint32_t shift = (offset & 2) * 8;
+    old &= ~(0xFFFFu << shift);
+    pci_config_write32(bus, slot, function, offset, old | ((uint32_t)value << shift));
+}
+
+static void pci_add_device(uint8_t bus, uint8_t slot, uint8_t function) {
+    if (device_count >= PCI_MAX_DEVICES) {
+        return;
+    }
+
+    struct pci_device* dev = &devices[device_count++];
+    uint32_t id = pci_config_read32(bus, slot, function, PCI_VENDOR_ID);
+    uint32_t class_reg = pci_config_read32(bus, slot, function, PCI_REVISION_ID);
+
+    dev->bus = bus;
+    dev->slot = slot;
+    dev->function = function;
+    dev->vendor_id = id & 0xFFFF;
+    dev->device_id = id >> 16;
+    dev->class_code = class_reg >> 24;
+    dev->subclass = (class_reg >> 16) & 0xFF;
+    dev->prog_if = (class_reg >> 8) & 0xFF;
+    dev->irq_line = pci_config_read32(bus, slot, function, PCI_INTERRUPT_LINE) & 0xFF;
+    for (int i = 0; i < 6; i++) {
+        dev->bar[i] = pci_config_read32(bus, slot, function, PCI_BAR0 + i * 4);
+    }
+}
+
+// Brute-force scan of every bus/slot/function
+void pci_init(void) {
+    device_count = 0;
+
+    for (uint16_t bus = 0; bus < 256; bus++) {
+        for (uint8_t slot = 0; slot < 32; slot++) {
+            if (pci_config_read16(bus, slot, 0, PCI_VENDOR_ID) == 0xFFFF) {
+                continue;
+            }
+
+            uint8_t header = pci_config_read16(bus, slot, 0, PCI_HEADER_TYPE) & 0xFF;
+            uint8_t functions = (header & 0x80) ? 8 : 1;
+
+            for (uint8_t function = 0; function < functions; function++) {
+                if (pci_config_read16(bus, slot, function, PCI_VENDOR_ID) != 0xFFFF) {
+                    pci_add_device(bus, slot, function);
+                }
+            }
+        }
+    }
+
+    log_write_string("PCI devices found: ");
+    log_write_hex(device_count);
+    log_write_string("\n");
+}
+
+struct pci_device* pci_find_device(uint16_t vendor_id, uint16_t device_id) {
+    for (size_t i = 0; i < device_count; i++) {
+        if (devices[i].vendor_id == vendor_id && devices[i].device_id == device_id) {
+            return &devices[i];
+        }
+    }
+    return NULL;
+}
+
+struct pci_device* pci_find_class(uint8_t class_code) {
+    for (size_t i = 0; i < device_count; i++) {
+        if (devices[i].class_code == class_code) {
+            return &devices[i];
+        }
+    }
+    return NULL;
+}
+
+// Size of a memory BAR: write all ones and see which address bits stick.
+// Decoding is off meanwhile so the device never answers at the probe value.
+uint32_t pci_bar_size(struct pci_device* dev, int bar) {
+    uint8_t offset = PCI_BAR0 + bar * 4;
+    uint16_t command = pci_config_read16(dev->bus, dev->slot, dev->function, PCI_COMMAND);
+
+    if (dev->bar[bar] & PCI_BAR_IO) {
+        return 0;
+    }
+
+    pci_config_write16(dev->bus, dev->slot, dev->function, PCI_COMMAND,
+                       command & ~(PCI_COMMAND_IO | PCI_COMMAND_MEMORY));
+    pci_config_write32(dev->bus, dev->slot, dev->function, offset, 0xFFFFFFFF);
+    uint32_t mask = pci_config_read32(dev->bus, dev->slot, dev->function, offset) & PCI_BAR_MEM_MASK;
+    pci_config_write32(dev->bus, dev->slot, dev->function, offset, dev->bar[bar]);
+    pci_config_write16(dev->bus, dev->slot, dev->function, PCI_COMMAND, command);
+
+    return mask ? ~mask + 1 : 0;
+}
+
+// Turn on I/O, memory decoding and DMA
+void pci_enable_device(struct pci_device* dev) {
+    uint16_t command = pci_config_read16(dev->bus, dev->slot, dev->function, PCI_COMMAND);
+    command |= PCI_COMMAND_IO | PCI_COMMAND_MEMORY | PCI_COMMAND_BUS_MASTER;
+    pci_config_write16(dev->bus, dev->slot, dev->function, PCI_COMMAND, command);
+}
+
+void pci_print_devices(void) {
+    terminal_writestring("Bus Slot Fn  Vendor     Device     Class\n");
+    for (size_t i = 0; i < device_count; i++) {
+        struct pci_device* dev = &devices[i];
+        terminal_writedec(dev->bus);
+        terminal_writestring("   ");
+        terminal_writedec(dev->slot);
+        terminal_writestring("    ");
+        terminal_writedec(dev->function);
+        terminal_writestring("   ");
+        terminal_writehex(dev->vendor_id);
+        terminal_writestring(" ");
+        terminal_writehex(dev->device_id);
+        terminal_writestring(" ");
+        terminal_writehex((dev->class_code << 8) | dev->subclass);
+        terminal_writestring("\n");
+    }
+}
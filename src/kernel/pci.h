@@ -0,0 +1,63 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// PCI configuration mechanism #1 ports
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA    0xCFC
+
+// Configuration space offsets
+#define PCI_VENDOR_ID      0x00
+#define PCI_DEVICE_ID      0x02
+#define PCI_COMMAND        0x04
+#define PCI_REVISION_ID    0x08
+#define PCI_HEADER_TYPE    0x0E
+#define PCI_BAR0           0x10
+#define PCI_SUBSYSTEM_ID   0x2E
+#define PCI_INTERRUPT_LINE 0x3C
+
+// Class codes
+#define PCI_CLASS_DISPLAY  0x03
+
+// Command register bits
+#define PCI_COMMAND_IO          0x1
+#define PCI_COMMAND_MEMORY      0x2
+#define PCI_COMMAND_BUS_MASTER  0x4
+
+// BAR bits
+#define PCI_BAR_IO         0x1
+#define PCI_BAR_MEM_64     0x4
+#define PCI_BAR_PREFETCH   0x8
+#define PCI_BAR_IO_MASK    0xFFFFFFFC
+#define PCI_BAR_MEM_MASK   0xFFFFFFF0
+
+#define PCI_MAX_DEVICES 32
+
+struct pci_device {
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t function;
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint8_t class_code;
+    uint8_t subclass;
+    uint8_t prog_if;
+    uint8_t irq_line;
+    uint32_t bar[6];
+};
+
+// PCI functions
+void pci_init(void);
+uint32_t pci_config_read32(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset);
+uint16_t pci_config_read16(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset);
+void pci_config_write32(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint32_t value);
+void pci_config_write16(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint16_t value);
+struct pci_device* pci_find_device(uint16_t vendor_id, uint16_t device_id);
+struct pci_device* pci_find_class(uint8_t class_code);
+uint32_t pci_bar_size(struct pci_device* dev, int bar);
+void pci_enable_device(struct pci_device* dev);
+void pci_print_devices(void);
+
+#endif // PCI_H
@@ -0,0 +1,59 @@
+#include <stdint.h>
+#include "pic.h"
+#include "io.h"
+
+#define PIC_EOI       0x20
+#define ICW1_INIT     0x10
+#define ICW1_ICW4     0x01
+#define ICW4_8086     0x01
+
+// Small delay between PIC commands (write to an unused port)
+static inline void io_wait(void) {
+    outb(0x80, 0);
+}
+
+void pic_init(void) {
+    // Start the initialization sequence in cascade mode
+    outb(PIC1_COMMAND, ICW1_INIT | ICW1_ICW4);
+    io_wait();
+    outb(PIC2_COMMAND, ICW1_INIT | ICW1_ICW4);
+    io_wait();
+
+    // Vector offsets
+    outb(PIC1_DATA, PIC1_OFFSET);
+    io_wait();
+    outb(PIC2_DATA, PIC2_OFFSET);
+    io_wait();
+
+    // Tell the master there is a slave on IRQ2, and the slave its identity
+    outb(PIC1_DATA, 1 << IRQ_CASCADE);
+    io_wait();
+    outb(PIC2_DATA, 2);
+    io_wait();
+
+    outb(PIC1_DATA, ICW4_8086);
+    io_wait();
+    outb(PIC2_DATA, ICW4_8086);
+    io_wait();
+
+    // Mask everything except the cascade line, drivers unmask what they use
+    outb(PIC1_DATA, (uint8_t)~(1 << IRQ_CASCADE));
+    outb(PIC2_DATA, 0xFF);
+}
+
+void pic_mask_irq(uint8_t irq) {
+    uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+    outb(port, inb(port) | (1 << (irq & 7)));
+}
+
+void pic_unmask_irq(uint8_t irq) {
+    uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+    outb(port, inb(port) & ~(1 << (irq & 7)));
+}
+
+void pic_send_eoi(uint8_t irq) {
+    if (irq >= 8) {
+        outb(PIC2_COMMAND, PIC_EOI);
+    }
+    outb(PIC1_COMMAND, PIC_EOI);
+}
@@ -0,0 +1,28 @@
+#ifndef PIC_H
+#define PIC_H
+
+#include <stdint.h>
+
+// 8259 PIC ports
+#define PIC1_COMMAND 0x20
+#define PIC1_DATA    0x21
+#define PIC2_COMMAND 0xA0
+#define PIC2_DATA    0xA1
+
+// Vector offsets after remapping (0x00-0x1F are CPU exceptions)
+#define PIC1_OFFSET 0x20
+#define PIC2_OFFSET 0x28
+
+// Legacy IRQ lines
+#define IRQ_PIT      0
+#define IRQ_KEYBOARD 1
+#define IRQ_CASCADE  2
+#define IRQ_COM1     4
+
+// PIC functions
+void pic_init(void);
+void pic_mask_irq(uint8_t irq);
+void pic_unmask_irq(uint8_t irq);
+void pic_send_eoi(uint8_t irq);
+
+#endif // PIC_H
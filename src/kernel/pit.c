@@ -0,0 +1,37 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "pit.h"
+#include "io.h"
+
+// Command byte fields
+#define PIT_SELECT_CH0   0x00
+#define PIT_SELECT_CH2   0x80
+#define PIT_ACCESS_LOHI  0x30
+#define PIT_MODE0        0x00  // Interrupt on terminal count
+
+// Start a countdown on channel 2; its output is polled instead of raising an
+// IRQ, which makes it usable for calibration before interrupts are enabled.
+void pit_delay_start(uint16_t count) {
+    // Gate on, speaker off
+    outb(PIT_GATE, (inb(PIT_GATE) & ~0x02) | 0x01);
+
+    outb(PIT_COMMAND, PIT_SELECT_CH2 | PIT_ACCESS_LOHI | PIT_MODE0);
+    outb(PIT_CHANNEL2, count & 0xFF);
+    outb(PIT_CHANNEL2, (count >> 8) & 0xFF);
+}
+
+bool pit_delay_expired(void) {
+    return (inb(PIT_GATE) & 0x20) != 0;  // OUT2 goes high on terminal count
+}
+
+// Fire IRQ0 once after count PIT ticks
+void pit_set_oneshot(uint16_t count) {
+    outb(PIT_COMMAND, PIT_SELECT_CH0 | PIT_ACCESS_LOHI | PIT_MODE0);
+    outb(PIT_CHANNEL0, count & 0xFF);
+    outb(PIT_CHANNEL0, (count >> 8) & 0xFF);
+}
+
+// Writing the mode without a count holds channel 0 until it is reloaded
+void pit_stop(void) {
+    outb(PIT_COMMAND, PIT_SELECT_CH0 | PIT_ACCESS_LOHI | PIT_MODE0);
+}
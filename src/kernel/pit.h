@@ -0,0 +1,25 @@
+#ifndef PIT_H
+#define PIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// 8253/8254 PIT ports
+#define PIT_CHANNEL0 0x40
+#define PIT_CHANNEL2 0x42
+#define PIT_COMMAND  0x43
+#define PIT_GATE     0x61  // Channel 2 gate / output status (keyboard controller port B)
+
+// Input clock of the PIT in Hz
+#define PIT_FREQUENCY 1193182
+
+// Longest interval a single 16-bit count can cover, in milliseconds
+#define PIT_MAX_ONESHOT_MS 54
+
+// PIT functions
+void pit_delay_start(uint16_t count);
+bool pit_delay_expired(void);
+void pit_set_oneshot(uint16_t count);
+void pit_stop(void);
+
+#endif // PIT_H
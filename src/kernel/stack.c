@@ -34,4 +34,42 @@ void print_kernel_stack(void) {
     }
     
     terminal_writestring("==================\n");
-} 
\ No newline at end of file
+}
+
+// Frames captured on the first step of stack_dump_task
+#define STACK_DUMP_MAX_FRAMES 32
+static uint32_t dump_ebp[STACK_DUMP_MAX_FRAMES];
+static uint32_t dump_eip[STACK_DUMP_MAX_FRAMES];
+static uint32_t dump_count = 0;
+
+int stack_dump_task(task_t* t) {
+    TASK_BEGIN(t);
+
+    // The chain has to be walked in one go: it is only valid during this step
+    {
+        uint32_t *ebp = (uint32_t *)get_base_pointer();
+        uint32_t *esp = (uint32_t *)get_stack_pointer();
+        dump_count = 0;
+        while (ebp > esp && dump_count < STACK_DUMP_MAX_FRAMES) {
+            dump_ebp[dump_count] = (uint32_t)ebp;
+            dump_eip[dump_count] = ebp[1];
+            dump_count++;
+            ebp = (uint32_t *)*ebp;
+        }
+    }
+
+    terminal_writestring("Kernel Stack Trace:\n");
+    terminal_writestring("==================\n");
+
+    for (t->arg = 0; t->arg < dump_count; t->arg++) {
+        terminal_writestring("EBP: 0x");
+        terminal_writehex(dump_ebp[t->arg]);
+        terminal_writestring("  EIP: 0x");
+        terminal_writehex(dump_eip[t->arg]);
+        terminal_writestring("\n");
+        TASK_YIELD(t);
+    }
+
+    terminal_writestring("==================\n");
+    TASK_END(t);
+}
@@ -2,10 +2,14 @@
 #define STACK_H
 
 #include <stdint.h>
+#include "task.h"
 
 // Function to print the current kernel stack
 void print_kernel_stack(void);
 
+// Task printing the stack of its caller one frame per step
+int stack_dump_task(task_t* task);
+
 // Function to get the current stack pointer
 uint32_t get_stack_pointer(void);
 
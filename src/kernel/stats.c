@@ -0,0 +1,114 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "stats.h"
+#include "cpu.h"
+#include "math64.h"
+#include "terminal.h"
+#include "log.h"
+#include "timer.h"
+
+struct stat_cpu stat_cpus[NR_CPUS];
+
+// Dotted names, also the keys of the serial dump
+static const char* const stat_names[STAT_COUNT] = {
+    [STAT_PORT_READS]         = "io.port_reads",
+    [STAT_PORT_WRITES]        = "io.port_writes",
+    [STAT_TERMINAL_CHARS]     = "terminal.chars",
+    [STAT_TERMINAL_VGA_CELLS] = "terminal.vga_cells",
+    [STAT_TERMINAL_SCROLLS]   = "terminal.scrolls",
+    [STAT_TERMINAL_CLEARS]    = "terminal.clears",
+    [STAT_TERMINAL_SWITCHES]  = "terminal.switches",
+    [STAT_KEYBOARD_IRQS]      = "keyboard.irqs",
+    [STAT_KEYBOARD_SCANCODES] = "keyboard.scancodes",
+    [STAT_KEYBOARD_DROPPED]   = "keyboard.dropped",
+    [STAT_UART_TX_BYTES]      = "uart.tx_bytes",
+    [STAT_SHELL_KEYSTROKES]   = "shell.keystrokes",
+    [STAT_SHELL_COMMANDS]     = "shell.commands",
+    [STAT_SHELL_UNKNOWN]      = "shell.unknown_commands",
+};
+
+// The halves of a counter are read with interrupts off so a local carry
+// cannot be seen half done
+uint64_t stats_read(enum stat_id id) {
+    uint64_t total = 0;
+    uint32_t flags = irq_save();
+
+    for (int cpu = 0; cpu < NR_CPUS; cpu++) {
+        total += stat_cpus[cpu].counters[id];
+    }
+
+    irq_restore(flags);
+    return total;
+}
+
+const char* stats_name(enum stat_id id) {
+    return id < STAT_COUNT ? stat_names[id] : "?";
+}
+
+// Decimal digits of value at the end of buf; returns the first digit
+static char* format_u64(char buf[21], uint64_t value) {
+    char* p = &buf[20];
+    *p = '\0';
+
+    do {
+        uint32_t digit;
+        value = div_u64_u32(value, 10, &digit);
+        *--p = (char)('0' + digit);
+    } while (value);
+
+    return p;
+}
+
+void stats_print(void) {
+    char buf[21];
+
+    for (int id = 0; id < STAT_COUNT; id++) {
+        size_t len = 0;
+        const char* name = stat_names[id];
+
+        terminal_writestring(name);
+        while (name[len]) {
+            len++;
+        }
+        for (; len < 26; len++) {
+            terminal_putchar(' ');
+        }
+        terminal_writestring(format_u64(buf, stats_read(id)));
+        terminal_putchar('\n');
+    }
+}
+
+static void append(char* line, size_t* len, const char* str) {
+    while (*str && *len < 79) {
+        line[(*len)++] = *str++;
+    }
+    line[*len] = '\0';
+}
+
+// One "name value" line per counter between begin and end markers, for
+// scripts reading COM1. The lines go to the UART log sink even when the log
+// is sent elsewhere, in order with other serial output, and each is one
+// write so other log output cannot split it.
+void stats_dump_serial(void) {
+    char buf[21];
+    char line[80];
+    size_t len = 0;
+
+    append(line, &len, "STATS BEGIN uptime_ms=");
+    append(line, &len, format_u64(buf, timer_now()));
+    append(line, &len, "\n");
+    log_write_to(LOG_SINK_UART, line, len);
+
+    for (int id = 0; id < STAT_COUNT; id++) {
+        len = 0;
+        append(line, &len, stat_names[id]);
+        append(line, &len, " ");
+        append(line, &len, format_u64(buf, stats_read(id)));
+        append(line, &len, "\n");
+        log_write_to(LOG_SINK_UART, line, len);
+    }
+
+    len = 0;
+    append(line, &len, "STATS END\n");
+    log_write_to(LOG_SINK_UART, line, len);
+}
@@ -0,0 +1,69 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include "cpu.h"
+
+// Kernel statistics counters. Every CPU has its own cache-line-aligned block
+// of 64-bit counters, so counting is a plain increment with no lock and no
+// shared cache line; stats_read() sums the CPUs.
+
+#define CACHE_LINE_SIZE 64
+
+// Add new counters here and give them a name in stats.c
+enum stat_id {
+    // Port I/O through io.h
+    STAT_PORT_READS,
+    STAT_PORT_WRITES,
+
+    // Terminal
+    STAT_TERMINAL_CHARS,
+    STAT_TERMINAL_VGA_CELLS,
+    STAT_TERMINAL_SCROLLS,
+    STAT_TERMINAL_CLEARS,
+    STAT_TERMINAL_SWITCHES,
+
+    // Keyboard
+    STAT_KEYBOARD_IRQS,
+    STAT_KEYBOARD_SCANCODES,
+    STAT_KEYBOARD_DROPPED,
+
+    // UART
+    STAT_UART_TX_BYTES,
+
+    // Shell
+    STAT_SHELL_KEYSTROKES,
+    STAT_SHELL_COMMANDS,
+    STAT_SHELL_UNKNOWN,
+
+    STAT_COUNT
+};
+
+struct stat_cpu {
+    uint64_t counters[STAT_COUNT];
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+extern struct stat_cpu stat_cpus[NR_CPUS];
+
+// add/adc on memory are each a single instruction, so an interrupt handler
+// counting in between cannot lose an update; CF survives the interrupt
+static inline void stats_add(enum stat_id id, uint32_t value) {
+    volatile uint32_t* counter = (volatile uint32_t*)&stat_cpus[cpu_id()].counters[id];
+    __asm__ volatile("addl %2, %0\n\t"
+                     "adcl $0, %1"
+                     : "+m"(counter[0]), "+m"(counter[1])
+                     : "ri"(value)
+                     : "cc");
+}
+
+static inline void stats_inc(enum stat_id id) {
+    stats_add(id, 1);
+}
+
+// Stats functions
+uint64_t stats_read(enum stat_id id);
+const char* stats_name(enum stat_id id);
+void stats_print(void);
+void stats_dump_serial(void);
+
+#endif // STATS_H
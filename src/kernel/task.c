@@ -0,0 +1,145 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "task.h"
+#include "cpu.h"
+#include "timer.h"
+#include "workqueue.h"
+
+// Steps run per scheduler pass before yielding to other deferred work
+#define TASK_BATCH 16
+
+// FIFO of tasks ready to run. It is drained by a single work item, so the
+// number of tasks is not limited by the size of the work queue.
+static task_t* ready_head = NULL;
+static task_t* ready_tail = NULL;
+static bool scheduler_posted = false;
+
+static void task_run_ready(uint32_t arg);
+
+// Called with interrupts disabled
+static void task_make_ready(task_t* task) {
+    if (task->state == TASK_STATE_QUEUED) {
+        return;
+    }
+
+    task->state = TASK_STATE_QUEUED;
+    task->next = NULL;
+    if (ready_tail) {
+        ready_tail->next = task;
+    } else {
+        ready_head = task;
+    }
+    ready_tail = task;
+
+    if (!scheduler_posted) {
+        scheduler_posted = work_post(task_run_ready, 0);
+    }
+}
+
+static task_t* task_pop_ready(void) {
+    uint32_t flags = irq_save();
+    task_t* task = ready_head;
+
+    if (task) {
+        ready_head = task->next;
+        if (!ready_head) {
+            ready_tail = NULL;
+        }
+        task->next = NULL;
+        task->state = TASK_STATE_IDLE;
+    }
+
+    irq_restore(flags);
+    return task;
+}
+
+static void task_step(task_t* task) {
+    int result = task->fn(task);
+
+    uint32_t flags = irq_save();
+    if (result == TASK_YIELDED) {
+        task_make_ready(task);
+    } else if (result == TASK_DONE) {
+        task->state = TASK_STATE_DONE;
+        timer_cancel(&task->timer);
+        task_event_signal(&task->exit);
+    }
+    irq_restore(flags);
+}
+
+static void task_run_ready(uint32_t arg __attribute__((unused))) {
+    for (int i = 0; i < TASK_BATCH; i++) {
+        task_t* task = task_pop_ready();
+        if (!task) {
+            break;
+        }
+        task_step(task);
+    }
+
+    uint32_t flags = irq_save();
+    scheduler_posted = false;
+    if (ready_head) {
+        scheduler_posted = work_post(task_run_ready, 0);
+    }
+    irq_restore(flags);
+}
+
+static void task_timer_fn(ktimer_t* timer __attribute__((unused)), void* data) {
+    task_t* task = (task_t*)data;
+
+    task->flags |= TASK_FLAG_TIMER_FIRED;
+    if (task->state == TASK_STATE_WAITING) {
+        task_make_ready(task);
+    }
+}
+
+void task_start(task_t* task, task_fn_t fn, uint32_t arg) {
+    task->line = 0;
+    task->state = TASK_STATE_IDLE;
+    task->flags = 0;
+    task->fn = fn;
+    task->next = NULL;
+    task->arg = arg;
+    task->exit.waiters = NULL;
+    task->exit.arm = NULL;
+    timer_setup(&task->timer, task_timer_fn, task);
+
+    uint32_t flags = irq_save();
+    task_make_ready(task);
+    irq_restore(flags);
+}
+
+// Park the running task on ev (or on nothing, for timer waits). Called by
+// TASK_AWAIT with interrupts disabled.
+void task_wait_on(task_t* task, task_event_t* ev) {
+    task->state = TASK_STATE_WAITING;
+
+    if (ev) {
+        task->next = ev->waiters;
+        ev->waiters = task;
+        if (ev->arm) {
+            ev->arm();
+        }
+    }
+}
+
+// Wake every task waiting on ev; they recheck their condition when they run
+void task_event_signal(task_event_t* ev) {
+    uint32_t flags = irq_save();
+    task_t* task = ev->waiters;
+    ev->waiters = NULL;
+
+    while (task) {
+        task_t* next = task->next;
+        task_make_ready(task);
+        task = next;
+    }
+
+    irq_restore(flags);
+}
+
+void task_sleep_start(task_t* task, uint32_t ms) {
+    task->flags &= ~TASK_FLAG_TIMER_FIRED;
+    timer_mod(&task->timer, timer_now() + ms);
+}
@@ -0,0 +1,92 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "cpu.h"
+
+// Stackless cooperative tasks (protothreads). A task is a function that is
+// re-entered from the top on every step and jumps back to where it left off
+// through a switch on the saved line number, so it needs no stack of its own.
+// Locals do not survive a wait: keep state in the task or in statics, and do
+// not put TASK_* macros inside a switch statement of your own.
+
+typedef struct task task_t;
+typedef struct task_event task_event_t;
+typedef int (*task_fn_t)(task_t* task);
+
+// Return values of a task step
+#define TASK_WAITING 0
+#define TASK_YIELDED 1
+#define TASK_DONE    2
+
+// Something tasks can wait for; signalled from interrupt or task context
+struct task_event {
+    task_t* waiters;
+    void (*arm)(void);     // Optional, called when a task starts waiting
+};
+
+struct task {
+    uint16_t line;         // Resume point
+    uint8_t state;
+    uint8_t flags;
+    task_fn_t fn;
+    task_t* next;          // Link in the ready list or an event's wait list
+    uint32_t arg;          // Free for the task's own use
+    task_event_t exit;     // Signalled when the task finishes
+    ktimer_t timer;        // Used by TASK_SLEEP
+};
+
+#define TASK_STATE_IDLE    0
+#define TASK_STATE_QUEUED  1
+#define TASK_STATE_WAITING 2
+#define TASK_STATE_DONE    3
+
+#define TASK_FLAG_TIMER_FIRED 0x1
+
+#define TASK_BEGIN(t)  switch ((t)->line) { case 0:
+#define TASK_END(t)    } (t)->line = 0; return TASK_DONE
+
+// Let other work run, then continue
+#define TASK_YIELD(t) \
+    do { (t)->line = __LINE__; return TASK_YIELDED; case __LINE__:; } while (0)
+
+// Sleep on ev until cond holds. cond is evaluated with interrupts disabled,
+// so a signal cannot be lost between the check and going to sleep.
+#define TASK_AWAIT(t, ev, cond) \
+    do { \
+        (t)->line = __LINE__; \
+        __attribute__((fallthrough)); \
+        case __LINE__: { \
+            uint32_t task_irq_flags_ = irq_save(); \
+            if (!(cond)) { \
+                task_wait_on((t), (ev)); \
+                irq_restore(task_irq_flags_); \
+                return TASK_WAITING; \
+            } \
+            irq_restore(task_irq_flags_); \
+        } \
+    } while (0)
+
+#define TASK_SLEEP(t, ms) \
+    do { \
+        task_sleep_start((t), (ms)); \
+        TASK_AWAIT((t), NULL, task_sleep_done(t)); \
+    } while (0)
+
+// Task functions
+void task_start(task_t* task, task_fn_t fn, uint32_t arg);
+void task_event_signal(task_event_t* ev);
+void task_wait_on(task_t* task, task_event_t* ev);
+void task_sleep_start(task_t* task, uint32_t ms);
+
+static inline bool task_done(const task_t* task) {
+    return task->state == TASK_STATE_DONE;
+}
+
+static inline bool task_sleep_done(const task_t* task) {
+    return (task->flags & TASK_FLAG_TIMER_FIRED) != 0;
+}
+
+#endif // TASK_H
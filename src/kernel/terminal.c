@@ -3,11 +3,17 @@
 #include <stdbool.h>
 #include "terminal.h"
 #include "io.h"
+#include "cpu.h"
 #include "uart.h"
+#include "log.h"
+#include "patch.h"
+#include "lock.h"
+#include "stats.h"
 
-// Memory barrier for VGA access
+// Video memory may be write-combining, so stores to it can sit in the
+// CPU's WC buffers; called wherever a screen update is complete
 static inline void vga_memory_barrier(void) {
-    asm volatile("" ::: "memory");
+    cpu_wc_flush();
 }
 
 // Screen structure to hold state
@@ -24,13 +30,26 @@ static screen_t screens[NUM_SCREENS];
 static uint8_t current_screen = 0;
 static volatile uint16_t* vga_buffer = (volatile uint16_t*)VGA_ADDRESS;
 
+// Serializes all screen state and VGA register access. Ticket order keeps
+// output from several writers in the order they asked for the terminal.
+// No interrupt handler writes to the terminal, so interrupts stay on while
+// it is held; a whole string with its scrolls can take milliseconds.
+DEFINE_TICKET_LOCK(terminal_lock, "terminal");
+
+// Copies terminal output to the log; a patched branch keeps it free while off
+DEFINE_STATIC_KEY(terminal_mirror_key, "mirror");
+
+// Set once the exception handler writes; mirroring would take the log lock
+static bool terminal_panicked = false;
+
 // Helper function to safely write to VGA buffer
 static void safe_vga_write(size_t index, uint16_t value) {
     if (index < VGA_HEIGHT * VGA_WIDTH) {
+        stats_inc(STAT_TERMINAL_VGA_CELLS);
         // Ensure compiler doesn't reorder memory operations
         asm volatile("" ::: "memory");
         // Write to VGA buffer
-        vga_buffer[index] = value;
+        mmio_write16(&vga_buffer[index], value);
         // Ensure write is complete
         asm volatile("" ::: "memory");
     }
@@ -42,11 +61,14 @@ static screen_t* get_current_screen(void) {
 }
 
 void terminal_setcolor(uint8_t color) {
+    ticket_lock(&terminal_lock);
     get_current_screen()->color = color;
+    ticket_unlock(&terminal_lock);
 }
 
-void terminal_scroll(void) {
+static void terminal_scroll_locked(void) {
     screen_t* screen = get_current_screen();
+    stats_inc(STAT_TERMINAL_SCROLLS);
     
     // Move all lines up by one
     for (size_t y = 0; y < VGA_HEIGHT - 1; y++) {
@@ -68,8 +90,17 @@ void terminal_scroll(void) {
     screen->row = VGA_HEIGHT - 1;
 }
 
+void terminal_scroll(void) {
+    ticket_lock(&terminal_lock);
+    terminal_scroll_locked();
+    vga_memory_barrier();
+    ticket_unlock(&terminal_lock);
+}
+
 void terminal_clear(void) {
+    ticket_lock(&terminal_lock);
     screen_t* screen = get_current_screen();
+    stats_inc(STAT_TERMINAL_CLEARS);
     
     // Clear the screen
     for (size_t y = 0; y < VGA_HEIGHT; y++) {
@@ -80,11 +111,16 @@ void terminal_clear(void) {
         }
     }
     
+    vga_memory_barrier();
+    
     screen->row = 0;
     screen->column = 0;
+    ticket_unlock(&terminal_lock);
 }
 
 void terminal_initialize(void) {
+    ticket_lock(&terminal_lock);
+
     // Initialize all screens
     for (uint8_t i = 0; i < NUM_SCREENS; i++) {
         screens[i].row = 0;
@@ -102,9 +138,12 @@ void terminal_initialize(void) {
         }
     }
     
+    vga_memory_barrier();
+    
     // Set current screen to 0 and initialize its prompt
     current_screen = 0;
     screens[0].prompt_initialized = true;
+    ticket_unlock(&terminal_lock);
     
     // Enable and position cursor
     terminal_enable_cursor();
@@ -116,12 +155,16 @@ void terminal_disable_cursor(void) {
     const uint16_t VGA_CTRL_REGISTER = 0x3D4;
     const uint16_t VGA_DATA_REGISTER = 0x3D5;
     
+    ticket_lock(&terminal_lock);
+    
     // Disable cursor by setting the maximum scan line to 0
     outb(VGA_CTRL_REGISTER, 0x0A);
     outb(VGA_DATA_REGISTER, 0x20);
     
     // Small delay to ensure register write completes
     for (volatile int i = 0; i < 100; i++);
+    
+    ticket_unlock(&terminal_lock);
 }
 
 void terminal_enable_cursor(void) {
@@ -129,6 +172,8 @@ void terminal_enable_cursor(void) {
     const uint16_t VGA_CTRL_REGISTER = 0x3D4;
     const uint16_t VGA_DATA_REGISTER = 0x3D5;
     
+    ticket_lock(&terminal_lock);
+    
     // Set cursor start line to 0 (top of character)
     outb(VGA_CTRL_REGISTER, 0x0A);
     outb(VGA_DATA_REGISTER, 0x00);
@@ -142,9 +187,11 @@ void terminal_enable_cursor(void) {
     
     // Small delay to ensure register write completes
     for (volatile int i = 0; i < 100; i++);
+    
+    ticket_unlock(&terminal_lock);
 }
 
-void terminal_update_cursor(void) {
+static void terminal_update_cursor_locked(void) {
     // VGA cursor control ports
     const uint16_t VGA_CTRL_REGISTER = 0x3D4;
     const uint16_t VGA_DATA_REGISTER = 0x3D5;
@@ -152,6 +199,9 @@ void terminal_update_cursor(void) {
     screen_t* screen = get_current_screen();
     uint16_t pos = screen->row * VGA_WIDTH + screen->column;
     
+    // The text must be on screen before the cursor moves past it
+    vga_memory_barrier();
+    
     // Update cursor position (low byte)
     outb(VGA_CTRL_REGISTER, 0x0F);
     outb(VGA_DATA_REGISTER, (uint8_t)(pos & 0xFF));
@@ -167,15 +217,39 @@ void terminal_update_cursor(void) {
     for (volatile int i = 0; i < 100; i++);
 }
 
-void terminal_putchar(char c) {
+void terminal_update_cursor(void) {
+    ticket_lock(&terminal_lock);
+    terminal_update_cursor_locked();
+    ticket_unlock(&terminal_lock);
+}
+
+void terminal_set_mirror(bool enabled) {
+    if (enabled) {
+        static_key_enable(&terminal_mirror_key);
+    } else {
+        static_key_disable(&terminal_mirror_key);
+    }
+}
+
+bool terminal_get_mirror(void) {
+    return static_key_enabled(&terminal_mirror_key);
+}
+
+static void terminal_putchar_locked(char c) {
     screen_t* screen = get_current_screen();
+    stats_inc(STAT_TERMINAL_CHARS);
+    
+    // Copy terminal output to the enabled log sinks
+    if (static_branch(&terminal_mirror_key) && !terminal_panicked) {
+        log_write(&c, 1);
+    }
     
     if (c == '\n') {
         screen->column = 0;
         if (++screen->row == VGA_HEIGHT) {
-            terminal_scroll();
+            terminal_scroll_locked();
         }
-        terminal_update_cursor();
+        terminal_update_cursor_locked();
         return;
     }
     
@@ -184,10 +258,10 @@ void terminal_putchar(char c) {
         if (screen->column >= VGA_WIDTH) {
             screen->column = 0;
             if (++screen->row == VGA_HEIGHT) {
-                terminal_scroll();
+                terminal_scroll_locked();
             }
         }
-        terminal_update_cursor();
+        terminal_update_cursor_locked();
         return;
     }
     
@@ -201,7 +275,7 @@ void terminal_putchar(char c) {
         const size_t index = screen->row * VGA_WIDTH + screen->column;
         screen->buffer[index] = vga_entry(' ', screen->color);
         safe_vga_write(index, screen->buffer[index]);
-        terminal_update_cursor();
+        terminal_update_cursor_locked();
         return;
     }
 
@@ -212,15 +286,28 @@ void terminal_putchar(char c) {
     if (++screen->column == VGA_WIDTH) {
         screen->column = 0;
         if (++screen->row == VGA_HEIGHT) {
-            terminal_scroll();
+            terminal_scroll_locked();
         }
     }
-    terminal_update_cursor();
+    terminal_update_cursor_locked();
 }
 
-void terminal_write(const char* data, size_t size) {
+void terminal_putchar(char c) {
+    ticket_lock(&terminal_lock);
+    terminal_putchar_locked(c);
+    ticket_unlock(&terminal_lock);
+}
+
+static void terminal_write_locked(const char* data, size_t size) {
     for (size_t i = 0; i < size; i++)
-        terminal_putchar(data[i]);
+        terminal_putchar_locked(data[i]);
+}
+
+// A whole write is kept together on screen
+void terminal_write(const char* data, size_t size) {
+    ticket_lock(&terminal_lock);
+    terminal_write_locked(data, size);
+    ticket_unlock(&terminal_lock);
 }
 
 // Custom strlen implementation
@@ -236,6 +323,26 @@ void terminal_writestring(const char* data) {
     terminal_write(data, strlen(data));
 }
 
+// For the exception handler. A held lock is ignored: with one CPU its holder
+// is the code that faulted, which may have left the position out of range.
+void terminal_panic_write(const char* data) {
+    bool locked = ticket_trylock(&terminal_lock);
+    screen_t* screen = get_current_screen();
+
+    terminal_panicked = true;
+    if (screen->row >= VGA_HEIGHT) {
+        screen->row = VGA_HEIGHT - 1;
+    }
+    if (screen->column >= VGA_WIDTH) {
+        screen->column = 0;
+    }
+    terminal_write_locked(data, strlen(data));
+
+    if (locked) {
+        ticket_unlock(&terminal_lock);
+    }
+}
+
 void terminal_writehex(uint32_t value) {
     const char* hex_chars = "0123456789ABCDEF";
     char hex_str[11];  // "0x" + 8 hex digits + null terminator
@@ -252,30 +359,60 @@ void terminal_writehex(uint32_t value) {
     terminal_writestring(hex_str);
 }
 
+void terminal_writedec(uint32_t value) {
+    char dec_str[11];  // 10 digits + null terminator
+    int i = 10;
+
+    dec_str[i] = '\0';
+    do {
+        dec_str[--i] = '0' + (value % 10);
+        value /= 10;
+    } while (value);
+
+    terminal_writestring(&dec_str[i]);
+}
+
+static void terminal_redraw_locked(void) {
+    screen_t* screen = get_current_screen();
+    
+    for (size_t i = 0; i < VGA_HEIGHT * VGA_WIDTH; i++) {
+        safe_vga_write(i, screen->buffer[i]);
+    }
+}
+
+// Rewrite all of VGA memory from the current screen's buffer
+void terminal_redraw(void) {
+    ticket_lock(&terminal_lock);
+    terminal_redraw_locked();
+    vga_memory_barrier();
+    ticket_unlock(&terminal_lock);
+}
+
 void terminal_switch_screen(uint8_t screen_num) {
     if (screen_num >= NUM_SCREENS) {
         return;
     }
     
+    ticket_lock(&terminal_lock);
+    
     // Save current screen state
     screen_t* current = get_current_screen();
     
     // Switch to new screen
     current_screen = screen_num;
+    stats_inc(STAT_TERMINAL_SWITCHES);
     
     // Copy the new screen's buffer to VGA memory
     screen_t* new_screen = get_current_screen();
-    
-    for (size_t i = 0; i < VGA_HEIGHT * VGA_WIDTH; i++) {
-        safe_vga_write(i, new_screen->buffer[i]);
-    }
+    terminal_redraw_locked();
     
     // Initialize prompt if this is the first time switching to this screen
     if (!new_screen->prompt_initialized) {
         new_screen->prompt_initialized = true;
-        terminal_writestring("> ");
+        terminal_write_locked("> ", 2);
     }
     
     // Update cursor position for the new screen
-    terminal_update_cursor();
+    terminal_update_cursor_locked();
+    ticket_unlock(&terminal_lock);
 } 
\ No newline at end of file
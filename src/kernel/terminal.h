@@ -3,11 +3,13 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 // VGA text mode constants
 #define VGA_WIDTH 80
 #define VGA_HEIGHT 25
 #define VGA_ADDRESS 0xB8000
+#define VGA_MEMORY_SIZE 0x8000     // Text mode window at VGA_ADDRESS
 #define NUM_SCREENS 12
 
 // VGA color constants
@@ -38,11 +40,17 @@ void terminal_putchar(char c);
 void terminal_write(const char* data, size_t size);
 void terminal_writestring(const char* data);
 void terminal_writehex(uint32_t value);
+void terminal_writedec(uint32_t value);
+void terminal_panic_write(const char* data);
 void terminal_clear(void);
+void terminal_scroll(void);
 void terminal_switch_screen(uint8_t screen_num);
+void terminal_redraw(void);
 void terminal_disable_cursor(void);
 void terminal_enable_cursor(void);
 void terminal_update_cursor(void);
+void terminal_set_mirror(bool enabled);
+bool terminal_get_mirror(void);
 
 // VGA helper functions
 static inline uint8_t vga_entry_color(enum vga_color fg, enum vga_color bg) {
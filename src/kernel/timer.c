@@ -0,0 +1,354 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "timer.h"
+#include "cpu.h"
+#include "tsc.h"
+#include "lapic.h"
+#include "pit.h"
+#include "pic.h"
+#include "idt.h"
+#include "log.h"
+
+// Hierarchical timing wheel: WHEEL_LEVELS levels of 64 slots, each level
+// covering 64 times the range of the one below. Level 0 has 1 ms slots.
+// Timers on higher levels are cascaded down when the lower levels wrap.
+#define WHEEL_BITS   6
+#define WHEEL_SIZE   (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_MAX_DELTA ((1u << (WHEEL_BITS * WHEEL_LEVELS)) - 1)  // ~4.6 hours
+
+// Hardware used to raise the next expiry
+enum clockevent {
+    CLOCKEVENT_NONE,
+    CLOCKEVENT_LAPIC,
+    CLOCKEVENT_PIT,
+};
+
+static struct {
+    ktimer_t* slots[WHEEL_LEVELS][WHEEL_SIZE];
+    uint64_t pending[WHEEL_LEVELS];   // Bitmap of non-empty slots per level
+    uint32_t clk;                     // Next tick to be processed
+    uint32_t count;                   // Number of pending timers
+} wheel;
+
+static enum clockevent clockevent = CLOCKEVENT_NONE;
+static uint64_t boot_tsc = 0;
+static bool armed = false;
+static uint32_t armed_expiry = 0;
+
+static inline unsigned int ctz64(uint64_t value) {
+    uint32_t low = (uint32_t)value;
+    return low ? __builtin_ctz(low) : 32 + __builtin_ctz((uint32_t)(value >> 32));
+}
+
+uint32_t timer_now(void) {
+    return (uint32_t)tsc_to_ms(rdtsc() - boot_tsc);
+}
+
+static void wheel_enqueue(ktimer_t* timer) {
+    uint32_t expires = timer->expires;
+    int32_t delta = (int32_t)(expires - wheel.clk);
+
+    // Already due timers go in the next slot processed; very distant ones
+    // wait in the last slot and get re-sorted when they cascade.
+    if (delta < 0) {
+        expires = wheel.clk;
+        delta = 0;
+    } else if ((uint32_t)delta > WHEEL_MAX_DELTA) {
+        expires = wheel.clk + WHEEL_MAX_DELTA;
+        delta = WHEEL_MAX_DELTA;
+    }
+
+    unsigned int level = 0;
+    while ((uint32_t)delta >= (1u << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    unsigned int index = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+
+    ktimer_t** head = &wheel.slots[level][index];
+    timer->next = *head;
+    if (timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    *head = timer;
+    timer->pprev = head;
+    timer->slot = (uint16_t)(level * WHEEL_SIZE + index);
+
+    wheel.pending[level] |= 1ULL << index;
+    wheel.count++;
+}
+
+static void wheel_dequeue(ktimer_t* timer) {
+    unsigned int level = timer->slot / WHEEL_SIZE;
+    unsigned int index = timer->slot % WHEEL_SIZE;
+
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->pprev = NULL;
+    timer->next = NULL;
+
+    if (!wheel.slots[level][index]) {
+        wheel.pending[level] &= ~(1ULL << index);
+    }
+    wheel.count--;
+}
+
+// Detach a whole slot, leaving its timers linked to each other
+static ktimer_t* wheel_take_slot(unsigned int level, unsigned int index) {
+    ktimer_t* list = wheel.slots[level][index];
+    unsigned int taken = 0;
+
+    for (ktimer_t* t = list; t; t = t->next) {
+        t->pprev = NULL;
+        taken++;
+    }
+    wheel.slots[level][index] = NULL;
+    wheel.pending[level] &= ~(1ULL << index);
+    wheel.count -= taken;
+    return list;
+}
+
+// Process tick wheel.clk: cascade the higher levels that wrap on it, then
+// run the timers of its level 0 slot.
+static void wheel_process_tick(void) {
+    uint32_t clk = wheel.clk;
+
+    for (unsigned int level = 1; level < WHEEL_LEVELS; level++) {
+        if (clk & ((1u << (WHEEL_BITS * level)) - 1)) {
+            break;
+        }
+        ktimer_t* t = wheel_take_slot(level, (clk >> (WHEEL_BITS * level)) & WHEEL_MASK);
+        while (t) {
+            ktimer_t* next = t->next;
+            wheel_enqueue(t);
+            t = next;
+        }
+    }
+
+    // Advance first so callbacks re-adding themselves land in a future slot
+    wheel.clk = clk + 1;
+
+    ktimer_t* t = wheel_take_slot(0, clk & WHEEL_MASK);
+    while (t) {
+        ktimer_t* next = t->next;
+        t->next = NULL;
+        t->fn(t, t->data);
+        t = next;
+    }
+}
+
+// Run everything that expired up to and including now
+static void wheel_advance(uint32_t now) {
+    while (time_after_eq(now, wheel.clk)) {
+        if (wheel.count == 0) {
+            wheel.clk = now + 1;
+            break;
+        }
+
+        // Skip the rest of a level 0 round that has nothing queued
+        unsigned int index = wheel.clk & WHEEL_MASK;
+        if (index != 0 && (wheel.pending[0] >> index) == 0) {
+            uint32_t boundary = (wheel.clk | WHEEL_MASK) + 1;
+            if (time_after(boundary, now)) {
+                wheel.clk = now + 1;
+                break;
+            }
+            wheel.clk = boundary;
+            continue;
+        }
+
+        wheel_process_tick();
+    }
+}
+
+// Earliest time at which the wheel has work: the first occupied level 0 slot
+// or the first cascade of an occupied higher level slot.
+static bool wheel_next_event(uint32_t* when) {
+    bool found = false;
+    uint32_t best = 0;
+
+    if (wheel.count == 0) {
+        return false;
+    }
+
+    for (unsigned int level = 0; level < WHEEL_LEVELS; level++) {
+        uint64_t bitmap = wheel.pending[level];
+        if (!bitmap) {
+            continue;
+        }
+
+        unsigned int shift = WHEEL_BITS * level;
+        uint32_t base = wheel.clk >> shift;
+        // The current slot of a higher level was already cascaded unless we
+        // sit exactly on its boundary
+        if (wheel.clk & ((1u << shift) - 1)) {
+            base++;
+        }
+        unsigned int start = base & WHEEL_MASK;
+        uint64_t rotated = start ? (bitmap >> start) | (bitmap << (WHEEL_SIZE - start)) : bitmap;
+        uint32_t event = (base + ctz64(rotated)) << shift;
+
+        if (!found || time_before(event, best)) {
+            best = event;
+            found = true;
+        }
+    }
+
+    *when = best;
+    return found;
+}
+
+static void clockevent_arm(uint32_t delta_ms) {
+    if (clockevent == CLOCKEVENT_LAPIC) {
+        uint32_t per_ms = lapic_timer_ticks_per_ms();
+        uint32_t ticks = delta_ms > 0xFFFFFFFF / per_ms ? 0xFFFFFFFF : delta_ms * per_ms;
+        lapic_timer_oneshot(ticks);
+    } else if (clockevent == CLOCKEVENT_PIT) {
+        if (delta_ms > PIT_MAX_ONESHOT_MS) {
+            delta_ms = PIT_MAX_ONESHOT_MS;
+        }
+        pit_set_oneshot((uint16_t)(delta_ms * (PIT_FREQUENCY / 1000)));
+    }
+}
+
+static void clockevent_stop(void) {
+    if (clockevent == CLOCKEVENT_LAPIC) {
+        lapic_timer_stop();
+    } else if (clockevent == CLOCKEVENT_PIT) {
+        pit_stop();
+    }
+}
+
+// Tickless operation: the hardware is only armed for the next expiry, and
+// left idle when no timer is pending. Called with interrupts disabled.
+static void timer_reprogram(uint32_t now) {
+    uint32_t next;
+
+    if (!wheel_next_event(&next)) {
+        if (armed) {
+            clockevent_stop();
+            armed = false;
+        }
+        return;
+    }
+
+    if (armed && armed_expiry == next) {
+        return;
+    }
+
+    int32_t delta = (int32_t)(next - now);
+    clockevent_arm(delta > 0 ? (uint32_t)delta : 1);
+    armed = true;
+    armed_expiry = next;
+}
+
+static void timer_interrupt(void) {
+    uint32_t now = timer_now();
+
+    armed = false;
+    wheel_advance(now);
+    timer_reprogram(timer_now());
+}
+
+static void lapic_timer_handler(struct interrupt_frame* frame __attribute__((unused))) {
+    timer_interrupt();
+    lapic_eoi();
+}
+
+static void pit_timer_handler(struct interrupt_frame* frame __attribute__((unused))) {
+    timer_interrupt();
+    pic_send_eoi(IRQ_PIT);
+}
+
+void timer_setup(ktimer_t* timer, timer_fn_t fn, void* data) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->slot = 0;
+    timer->fn = fn;
+    timer->data = data;
+}
+
+void timer_add(ktimer_t* timer, uint32_t expires) {
+    timer_mod(timer, expires);
+}
+
+// Returns whether the timer was pending before
+bool timer_mod(ktimer_t* timer, uint32_t expires) {
+    uint32_t flags = irq_save();
+    bool was_pending = timer_pending(timer);
+
+    if (was_pending) {
+        if (timer->expires == expires) {
+            irq_restore(flags);
+            return true;
+        }
+        wheel_dequeue(timer);
+    }
+
+    // Catch an idle wheel up before queueing relative to its clock
+    uint32_t now = timer_now();
+    if (wheel.count == 0) {
+        wheel.clk = now;
+    }
+
+    timer->expires = expires;
+    wheel_enqueue(timer);
+    timer_reprogram(now);
+
+    irq_restore(flags);
+    return was_pending;
+}
+
+// Returns whether the timer was pending
+bool timer_cancel(ktimer_t* timer) {
+    uint32_t flags = irq_save();
+    bool was_pending = timer_pending(timer);
+
+    if (was_pending) {
+        wheel_dequeue(timer);
+        timer_reprogram(timer_now());
+    }
+
+    irq_restore(flags);
+    return was_pending;
+}
+
+const char* timer_clockevent_name(void) {
+    switch (clockevent) {
+    case CLOCKEVENT_LAPIC:
+        return "lapic";
+    case CLOCKEVENT_PIT:
+        return "pit";
+    default:
+        return "none";
+    }
+}
+
+void timer_init(void) {
+    if (!tsc_init()) {
+        log_write_string("No clock source, timers disabled\n");
+        return;
+    }
+
+    if (lapic_init()) {
+        idt_register_handler(LAPIC_TIMER_VECTOR, lapic_timer_handler);
+        clockevent = CLOCKEVENT_LAPIC;
+    } else {
+        idt_register_handler(PIC1_OFFSET + IRQ_PIT, pit_timer_handler);
+        pit_stop();
+        pic_unmask_irq(IRQ_PIT);
+        clockevent = CLOCKEVENT_PIT;
+    }
+
+    boot_tsc = rdtsc();
+    wheel.clk = 0;
+
+    log_write_string("Timer clock event: ");
+    log_write_string(timer_clockevent_name());
+    log_write_string("\n");
+}
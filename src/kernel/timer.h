@@ -0,0 +1,39 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Kernel timers. Times are absolute milliseconds since timer_init(), stored
+// in 32 bits and compared with the wrap-safe helpers below.
+typedef struct ktimer ktimer_t;
+typedef void (*timer_fn_t)(ktimer_t* timer, void* data);
+
+struct ktimer {
+    ktimer_t* next;      // Next timer in the same wheel slot
+    ktimer_t** pprev;    // Link pointing at us, NULL when not pending
+    uint32_t expires;    // Expiry time in ms
+    uint16_t slot;       // Wheel slot we are queued in
+    timer_fn_t fn;       // Callback, runs in interrupt context
+    void* data;
+};
+
+// Wrap-safe time comparisons
+#define time_after(a, b)     ((int32_t)((b) - (a)) < 0)
+#define time_after_eq(a, b)  ((int32_t)((a) - (b)) >= 0)
+#define time_before(a, b)    time_after(b, a)
+
+// Timer functions
+void timer_init(void);
+uint32_t timer_now(void);
+void timer_setup(ktimer_t* timer, timer_fn_t fn, void* data);
+void timer_add(ktimer_t* timer, uint32_t expires);
+bool timer_mod(ktimer_t* timer, uint32_t expires);
+bool timer_cancel(ktimer_t* timer);
+const char* timer_clockevent_name(void);
+
+static inline bool timer_pending(const ktimer_t* timer) {
+    return timer->pprev != 0;
+}
+
+#endif // TIMER_H
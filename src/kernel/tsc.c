@@ -0,0 +1,65 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "tsc.h"
+#include "pit.h"
+#include "math64.h"
+#include "log.h"
+
+// Calibration window: 10 ms worth of PIT ticks
+#define CALIBRATE_MS 10
+#define CALIBRATE_PIT_COUNT (PIT_FREQUENCY / (1000 / CALIBRATE_MS))
+
+// Fixed-point conversion factors: unit = (cycles * mult) >> shift
+#define NS_SHIFT 24
+#define US_SHIFT 32
+#define MS_SHIFT 42
+
+static uint32_t tsc_khz = 0;
+static uint32_t ns_mult = 0;
+static uint32_t us_mult = 0;
+static uint32_t ms_mult = 0;
+
+bool tsc_init(void) {
+    if (!cpu_has_edx_feature(CPUID_EDX_TSC)) {
+        log_write_string("TSC not supported\n");
+        return false;
+    }
+
+    // Count TSC cycles across a known PIT interval
+    pit_delay_start(CALIBRATE_PIT_COUNT);
+    uint64_t start = rdtsc();
+    while (!pit_delay_expired());
+    uint64_t cycles = rdtsc() - start;
+
+    tsc_khz = (uint32_t)cycles / CALIBRATE_MS;
+    if (tsc_khz == 0) {
+        log_write_string("TSC calibration failed\n");
+        return false;
+    }
+
+    ns_mult = (uint32_t)div_u64_u32(1000000ULL << NS_SHIFT, tsc_khz, NULL);
+    us_mult = (uint32_t)div_u64_u32(1000ULL << US_SHIFT, tsc_khz, NULL);
+    ms_mult = (uint32_t)div_u64_u32(1ULL << MS_SHIFT, tsc_khz, NULL);
+
+    log_write_string("TSC frequency (kHz): ");
+    log_write_hex(tsc_khz);
+    log_write_string("\n");
+    return true;
+}
+
+uint32_t tsc_get_khz(void) {
+    return tsc_khz;
+}
+
+uint64_t tsc_to_ns(uint64_t cycles) {
+    return mul_u64_u32_shr(cycles, ns_mult, NS_SHIFT);
+}
+
+uint64_t tsc_to_us(uint64_t cycles) {
+    return mul_u64_u32_shr(cycles, us_mult, US_SHIFT);
+}
+
+uint64_t tsc_to_ms(uint64_t cycles) {
+    return mul_u64_u32_shr(cycles, ms_mult, MS_SHIFT);
+}
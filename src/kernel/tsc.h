@@ -0,0 +1,25 @@
+#ifndef TSC_H
+#define TSC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cpu.h"
+#include "patch.h"
+
+// rdtsc that cannot be executed ahead of earlier instructions, for timing a
+// piece of code; lfence is patched in where SSE2 provides it
+static inline uint64_t rdtsc_ordered(void) {
+    uint32_t low, high;
+    __asm__ volatile(ALTERNATIVE("", "lfence", FEATURE_EDX_SSE2) "\n\trdtsc"
+                     : "=a"(low), "=d"(high) : : "memory");
+    return ((uint64_t)high << 32) | low;
+}
+
+// TSC functions
+bool tsc_init(void);
+uint32_t tsc_get_khz(void);
+uint64_t tsc_to_ns(uint64_t cycles);
+uint64_t tsc_to_us(uint64_t cycles);
+uint64_t tsc_to_ms(uint64_t cycles);
+
+#endif // TSC_H
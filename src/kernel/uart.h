@@ -2,14 +2,23 @@
 #define UART_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 // UART ports
 #define UART_PORT 0x3F8
 
+// Bytes the transmit FIFO holds once the holding register reports empty
+#define UART_FIFO_SIZE 16
+
 // UART functions
 void uart_init(void);
 void uart_write_char(char c);
 void uart_write_string(const char* str);
 void uart_write_hex(uint32_t value);
+bool uart_tx_ready(void);
+void uart_send(char c);
+void uart_set_tx_interrupt(bool enable);
+void uart_panic_write(const char* data, size_t len);
 
 #endif 
\ No newline at end of file
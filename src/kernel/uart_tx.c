@@ -0,0 +1,106 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "uart_tx.h"
+#include "uart.h"
+#include "io.h"
+#include "task.h"
+#include "cpu.h"
+#include "idt.h"
+#include "pic.h"
+#include "log.h"
+#include "lock.h"
+
+#define UART_TX_BUFFER_SIZE 4096   // Power of two
+
+// Log output waiting for the transmitter. Written by the log sink, drained
+// by uart_tx_task, both under uart_tx_lock.
+static char tx_buffer[UART_TX_BUFFER_SIZE];
+static uint32_t tx_head = 0;
+static uint32_t tx_tail = 0;
+DEFINE_SPINLOCK(uart_tx_lock, "uart tx");
+
+static task_t uart_tx_task;
+
+static void uart_tx_arm(void);
+
+task_event_t uart_tx_event = { NULL, uart_tx_arm };
+
+// Only ask for the THRE interrupt when there is something left to send
+static void uart_tx_arm(void) {
+    if (tx_head != tx_tail) {
+        uart_set_tx_interrupt(true);
+    }
+}
+
+static void uart_irq_handler(struct interrupt_frame* frame __attribute__((unused))) {
+    // Reading IIR acknowledges a THRE interrupt
+    inb(UART_PORT + 2);
+    uart_set_tx_interrupt(false);
+    task_event_signal(&uart_tx_event);
+    pic_send_eoi(IRQ_COM1);
+}
+
+static bool uart_tx_can_send(void) {
+    return tx_head != tx_tail && uart_tx_ready();
+}
+
+// Refill the FIFO each time it runs empty
+static int uart_tx_fn(task_t* t) {
+    TASK_BEGIN(t);
+    while (1) {
+        TASK_AWAIT(t, &uart_tx_event, uart_tx_can_send());
+
+        uint32_t flags = spin_lock_irqsave(&uart_tx_lock);
+        for (int i = 0; i < UART_FIFO_SIZE && tx_tail != tx_head; i++) {
+            uart_send(tx_buffer[tx_tail % UART_TX_BUFFER_SIZE]);
+            tx_tail++;
+        }
+        spin_unlock_irqrestore(&uart_tx_lock, flags);
+    }
+    TASK_END(t);
+}
+
+// When the buffer is full the oldest bytes are sent synchronously, so output
+// order is kept and nothing is dropped
+static void uart_tx_sink(const char* data, size_t len) {
+    uint32_t flags = spin_lock_irqsave(&uart_tx_lock);
+
+    for (size_t i = 0; i < len; i++) {
+        if (tx_head - tx_tail == UART_TX_BUFFER_SIZE) {
+            uart_write_char(tx_buffer[tx_tail % UART_TX_BUFFER_SIZE]);
+            tx_tail++;
+        }
+        tx_buffer[tx_head % UART_TX_BUFFER_SIZE] = data[i];
+        tx_head++;
+    }
+
+    spin_unlock_irqrestore(&uart_tx_lock, flags);
+    task_event_signal(&uart_tx_event);
+}
+
+// Send everything still buffered by polling the transmitter, for the
+// exception handler once uart_tx_task will never run again. A held lock is
+// ignored: with one CPU its holder is the code that faulted.
+void uart_tx_flush(void) {
+    uint32_t flags = irq_save();
+    bool locked = spin_trylock(&uart_tx_lock);
+
+    while (tx_tail != tx_head) {
+        uart_panic_write(&tx_buffer[tx_tail % UART_TX_BUFFER_SIZE], 1);
+        tx_tail++;
+    }
+
+    if (locked) {
+        spin_unlock(&uart_tx_lock);
+    }
+    irq_restore(flags);
+}
+
+void uart_tx_init(void) {
+    idt_register_handler(PIC1_OFFSET + IRQ_COM1, uart_irq_handler);
+    pic_unmask_irq(IRQ_COM1);
+
+    task_start(&uart_tx_task, uart_tx_fn, 0);
+    log_register_sink(LOG_SINK_UART, uart_tx_sink);
+}
@@ -0,0 +1,13 @@
+#ifndef UART_TX_H
+#define UART_TX_H
+
+#include "task.h"
+
+// Signalled when the UART transmitter has room again
+extern task_event_t uart_tx_event;
+
+// Switch the UART log sink from busy-waiting to a buffer drained by a task
+void uart_tx_init(void);
+void uart_tx_flush(void);
+
+#endif // UART_TX_H
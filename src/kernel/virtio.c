@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "virtio.h"
+#include "io.h"
+
+// The device is another agent reading guest memory: keep the compiler from
+// reordering ring updates (x86 does not reorder stores with other stores)
+static inline void virtio_barrier(void) {
+    __asm__ volatile("" ::: "memory");
+}
+
+void virtio_reset(uint16_t io_base) {
+    outb(io_base + VIRTIO_PCI_STATUS, 0);
+}
+
+void virtio_set_status(uint16_t io_base, uint8_t status) {
+    outb(io_base + VIRTIO_PCI_STATUS, inb(io_base + VIRTIO_PCI_STATUS) | status);
+}
+
+// Lay out a legacy split ring in mem (VIRTQ_MEM_SIZE bytes, page aligned)
+// and hand its page frame to the device
+bool virtq_init(struct virtq* vq, uint16_t io_base, uint16_t index, void* mem) {
+    outw(io_base + VIRTIO_PCI_QUEUE_SEL, index);
+    uint16_t size = inw(io_base + VIRTIO_PCI_QUEUE_NUM);
+    if (size == 0 || size > VIRTQ_MAX_SIZE) {
+        return false;
+    }
+
+    uint8_t* base = (uint8_t*)mem;
+    for (size_t i = 0; i < VIRTQ_MEM_SIZE; i++) {
+        base[i] = 0;
+    }
+
+    uint32_t avail_offset = size * sizeof(struct vring_desc);
+    uint32_t used_offset = avail_offset + sizeof(struct vring_avail) + (size + 1) * sizeof(uint16_t);
+    used_offset = (used_offset + VRING_ALIGN - 1) & ~(VRING_ALIGN - 1);
+
+    vq->io_base = io_base;
+    vq->index = index;
+    vq->size = size;
+    vq->avail_shadow = 0;
+    vq->last_used = 0;
+    vq->desc = (volatile struct vring_desc*)base;
+    vq->avail = (volatile struct vring_avail*)(base + avail_offset);
+    vq->used = (volatile struct vring_used*)(base + used_offset);
+    vq->kicks = 0;
+
+    // Completions are polled, never signalled
+    vq->avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+
+    outl(io_base + VIRTIO_PCI_QUEUE_PFN, (uint32_t)base / VRING_ALIGN);
+    return true;
+}
+
+// Queue a single-buffer chain. It only becomes visible to the device at the
+// next virtq_kick(), so several buffers share one notification.
+void virtq_submit(struct virtq* vq, uint16_t id, const void* buf, uint32_t len, uint16_t flags) {
+    vq->desc[id].addr = (uint32_t)buf;
+    vq->desc[id].len = len;
+    vq->desc[id].flags = flags;
+    vq->desc[id].next = 0;
+
+    vq->avail->ring[vq->avail_shadow % vq->size] = id;
+    vq->avail_shadow++;
+}
+
+// Publish everything submitted since the last kick and notify the device
+void virtq_kick(struct virtq* vq) {
+    if (vq->avail->idx == vq->avail_shadow) {
+        return;
+    }
+
+    virtio_barrier();
+    vq->avail->idx = vq->avail_shadow;
+    virtio_barrier();
+
+    if (!(vq->used->flags & VRING_USED_F_NO_NOTIFY)) {
+        outw(vq->io_base + VIRTIO_PCI_QUEUE_NOTIFY, vq->index);
+        vq->kicks++;
+    }
+}
+
+// Pop one completed descriptor id; the buffer it points at is reusable as is
+bool virtq_reclaim(struct virtq* vq, uint16_t* id) {
+    if (vq->last_used == vq->used->idx) {
+        return false;
+    }
+
+    virtio_barrier();
+    *id = (uint16_t)vq->used->ring[vq->last_used % vq->size].id;
+    vq->last_used++;
+    return true;
+}
+
+uint16_t virtq_in_flight(const struct virtq* vq) {
+    return (uint16_t)(vq->avail_shadow - vq->last_used);
+}
@@ -0,0 +1,86 @@
+#ifndef VIRTIO_H
+#define VIRTIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Virtio PCI vendor
+#define VIRTIO_VENDOR_ID 0x1AF4
+
+// Legacy virtio-pci register offsets in the I/O BAR
+#define VIRTIO_PCI_HOST_FEATURES  0x00
+#define VIRTIO_PCI_GUEST_FEATURES 0x04
+#define VIRTIO_PCI_QUEUE_PFN      0x08
+#define VIRTIO_PCI_QUEUE_NUM      0x0C
+#define VIRTIO_PCI_QUEUE_SEL      0x0E
+#define VIRTIO_PCI_QUEUE_NOTIFY   0x10
+#define VIRTIO_PCI_STATUS         0x12
+#define VIRTIO_PCI_ISR            0x13
+#define VIRTIO_PCI_CONFIG         0x14
+
+// Device status bits
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01
+#define VIRTIO_STATUS_DRIVER      0x02
+#define VIRTIO_STATUS_DRIVER_OK   0x04
+#define VIRTIO_STATUS_FAILED      0x80
+
+// Ring flags
+#define VRING_DESC_F_NEXT         0x1
+#define VRING_DESC_F_WRITE        0x2
+#define VRING_AVAIL_F_NO_INTERRUPT 0x1
+#define VRING_USED_F_NO_NOTIFY    0x1
+
+// Legacy rings are laid out with this alignment
+#define VRING_ALIGN 4096
+
+// Largest queue the statically reserved ring memory can hold
+#define VIRTQ_MAX_SIZE 256
+#define VIRTQ_MEM_SIZE (3 * VRING_ALIGN)
+
+struct vring_desc {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+};
+
+struct vring_avail {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+};
+
+struct vring_used_elem {
+    uint32_t id;
+    uint32_t len;
+};
+
+struct vring_used {
+    uint16_t flags;
+    uint16_t idx;
+    struct vring_used_elem ring[];
+};
+
+struct virtq {
+    uint16_t io_base;
+    uint16_t index;
+    uint16_t size;
+    uint16_t avail_shadow;      // Next avail index, published on kick
+    uint16_t last_used;         // Next used entry to reclaim
+    volatile struct vring_desc* desc;
+    volatile struct vring_avail* avail;
+    volatile struct vring_used* used;
+    uint32_t kicks;
+};
+
+// Virtio functions
+void virtio_reset(uint16_t io_base);
+void virtio_set_status(uint16_t io_base, uint8_t status);
+bool virtq_init(struct virtq* vq, uint16_t io_base, uint16_t index, void* mem);
+void virtq_submit(struct virtq* vq, uint16_t id, const void* buf, uint32_t len, uint16_t flags);
+void virtq_kick(struct virtq* vq);
+bool virtq_reclaim(struct virtq* vq, uint16_t* id);
+uint16_t virtq_in_flight(const struct virtq* vq);
+
+#endif // VIRTIO_H
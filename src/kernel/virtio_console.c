@@ -0,0 +1,206 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "virtio_console.h"
+#include "virtio.h"
+#include "pci.h"
+#include "io.h"
+#include "cpu.h"
+#include "timer.h"
+#include "log.h"
+
+// Port 0 queues; only transmit is used
+#define TX_QUEUE 1
+
+// Output is copied once into fixed chunks, each permanently owned by the
+// descriptor with the same index. Reclaiming a used descriptor therefore only
+// returns its index to the free list.
+#define TX_CHUNK_SIZE 1024
+#define TX_CHUNKS     64
+#define TX_BATCH      16   // Full buffers queued before notifying the device
+#define TX_FLUSH_MS   1    // Upper bound on how long partial output waits
+
+static uint8_t tx_ring_mem[VIRTQ_MEM_SIZE] __attribute__((aligned(VRING_ALIGN)));
+static uint8_t tx_chunks[TX_CHUNKS][TX_CHUNK_SIZE];
+
+static struct virtq tx_vq;
+static bool present = false;
+static uint16_t chunk_count = 0;
+
+static uint16_t free_ids[TX_CHUNKS];
+static uint16_t free_count = 0;
+
+static int32_t open_id = -1;     // Chunk being filled, -1 if none
+static uint32_t open_len = 0;
+static uint32_t unkicked = 0;    // Buffers submitted since the last kick
+
+static ktimer_t flush_timer;
+static struct virtio_console_stats stats;
+
+static void reclaim_used(void) {
+    uint16_t id;
+    while (virtq_reclaim(&tx_vq, &id)) {
+        free_ids[free_count++] = id;
+    }
+}
+
+static void kick(void) {
+    uint32_t before = tx_vq.kicks;
+    virtq_kick(&tx_vq);
+    stats.kicks += tx_vq.kicks - before;
+    unkicked = 0;
+}
+
+// Get a chunk to fill, waiting for the device to hand one back if needed
+static void open_chunk(void) {
+    reclaim_used();
+    if (free_count == 0) {
+        kick();
+        while (free_count == 0) {
+            reclaim_used();
+        }
+    }
+
+    open_id = free_ids[--free_count];
+    open_len = 0;
+}
+
+static void submit_chunk(void) {
+    if (open_id < 0 || open_len == 0) {
+        return;
+    }
+
+    virtq_submit(&tx_vq, (uint16_t)open_id, tx_chunks[open_id], open_len, 0);
+    stats.buffers++;
+    open_id = -1;
+    open_len = 0;
+
+    if (++unkicked >= TX_BATCH) {
+        kick();
+    }
+}
+
+static void flush_timer_fn(ktimer_t* timer __attribute__((unused)), void* data __attribute__((unused))) {
+    virtio_console_flush();
+}
+
+void virtio_console_write(const char* data, size_t len) {
+    if (!present) {
+        return;
+    }
+
+    uint32_t flags = irq_save();
+
+    while (len > 0) {
+        if (open_id < 0) {
+            open_chunk();
+        }
+
+        uint8_t* chunk = tx_chunks[open_id];
+        size_t room = TX_CHUNK_SIZE - open_len;
+        size_t count = len < room ? len : room;
+        for (size_t i = 0; i < count; i++) {
+            chunk[open_len + i] = data[i];
+        }
+        open_len += count;
+        data += count;
+        len -= count;
+        stats.bytes += count;
+
+        if (open_len == TX_CHUNK_SIZE) {
+            submit_chunk();
+        }
+    }
+
+    // Partial output goes out at the latest TX_FLUSH_MS from now
+    if (!timer_pending(&flush_timer)) {
+        timer_add(&flush_timer, timer_now() + TX_FLUSH_MS);
+    }
+
+    irq_restore(flags);
+}
+
+// Submit the partially filled chunk and notify the device
+void virtio_console_flush(void) {
+    if (!present) {
+        return;
+    }
+
+    uint32_t flags = irq_save();
+    submit_chunk();
+    kick();
+    reclaim_used();
+    irq_restore(flags);
+}
+
+// Flush and wait until the device has consumed everything
+void virtio_console_drain(void) {
+    if (!present) {
+        return;
+    }
+
+    virtio_console_flush();
+
+    uint32_t flags = irq_save();
+    while (free_count < chunk_count) {
+        reclaim_used();
+    }
+    irq_restore(flags);
+}
+
+void virtio_console_get_stats(struct virtio_console_stats* out) {
+    *out = stats;
+}
+
+bool virtio_console_present(void) {
+    return present;
+}
+
+static void virtio_console_sink(const char* data, size_t len) {
+    virtio_console_write(data, len);
+}
+
+bool virtio_console_init(void) {
+    struct pci_device* dev = pci_find_device(VIRTIO_VENDOR_ID, VIRTIO_CONSOLE_DEVICE_ID);
+    if (!dev) {
+        log_write_string("virtio-console: no device\n");
+        return false;
+    }
+    if (!(dev->bar[0] & PCI_BAR_IO)) {
+        log_write_string("virtio-console: BAR0 is not an I/O BAR\n");
+        return false;
+    }
+
+    uint16_t io_base = dev->bar[0] & PCI_BAR_IO_MASK;
+    pci_enable_device(dev);
+
+    virtio_reset(io_base);
+    virtio_set_status(io_base, VIRTIO_STATUS_ACKNOWLEDGE);
+    virtio_set_status(io_base, VIRTIO_STATUS_DRIVER);
+
+    // No optional features: a single port on queues 0/1 is all we need
+    outl(io_base + VIRTIO_PCI_GUEST_FEATURES, 0);
+
+    if (!virtq_init(&tx_vq, io_base, TX_QUEUE, tx_ring_mem)) {
+        virtio_set_status(io_base, VIRTIO_STATUS_FAILED);
+        log_write_string("virtio-console: transmit queue setup failed\n");
+        return false;
+    }
+
+    chunk_count = tx_vq.size < TX_CHUNKS ? tx_vq.size : TX_CHUNKS;
+    for (uint16_t i = 0; i < chunk_count; i++) {
+        free_ids[i] = i;
+    }
+    free_count = chunk_count;
+
+    timer_setup(&flush_timer, flush_timer_fn, NULL);
+    virtio_set_status(io_base, VIRTIO_STATUS_DRIVER_OK);
+
+    present = true;
+    log_register_sink(LOG_SINK_VIRTIO, virtio_console_sink);
+
+    log_write_string("virtio-console: queue size ");
+    log_write_hex(tx_vq.size);
+    log_write_string("\n");
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef VIRTIO_CONSOLE_H
+#define VIRTIO_CONSOLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Legacy / transitional virtio console PCI device id
+#define VIRTIO_CONSOLE_DEVICE_ID 0x1003
+
+// Transmit statistics
+struct virtio_console_stats {
+    uint32_t bytes;
+    uint32_t buffers;
+    uint32_t kicks;
+};
+
+// Virtio console functions
+bool virtio_console_init(void);
+bool virtio_console_present(void);
+void virtio_console_write(const char* data, size_t len);
+void virtio_console_flush(void);
+void virtio_console_drain(void);
+void virtio_console_get_stats(struct virtio_console_stats* stats);
+
+#endif // VIRTIO_CONSOLE_H
@@ -0,0 +1,127 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "workqueue.h"
+#include "cpu.h"
+#include "tsc.h"
+#include "math64.h"
+#include "terminal.h"
+
+struct work_item {
+    work_fn_t fn;
+    uint32_t arg;
+    uint64_t posted_tsc;
+};
+
+// Single-producer/single-consumer ring per CPU. Interrupt handlers on a CPU
+// are the only producers (interrupt gates do not nest) and that CPU's main
+// loop is the only consumer, so head and tail need no lock: each index is
+// written by one side only.
+struct work_queue {
+    struct work_item items[WORK_QUEUE_SIZE];
+    volatile uint32_t head;   // Written by the producer
+    volatile uint32_t tail;   // Written by the consumer
+    struct work_stats stats;
+} __attribute__((aligned(64)));
+
+static struct work_queue queues[NR_CPUS];
+
+// Safe from any context: outside interrupts it briefly disables them so it
+// cannot race with a handler on the same CPU
+bool work_post(work_fn_t fn, uint32_t arg) {
+    uint32_t flags = irq_save();
+    struct work_queue* q = &queues[cpu_id()];
+    uint32_t head = q->head;
+    uint32_t depth = head - q->tail;
+
+    if (depth >= WORK_QUEUE_SIZE) {
+        q->stats.dropped++;
+        irq_restore(flags);
+        return false;
+    }
+
+    struct work_item* item = &q->items[head % WORK_QUEUE_SIZE];
+    item->fn = fn;
+    item->arg = arg;
+    item->posted_tsc = rdtsc();
+
+    __asm__ volatile("" ::: "memory");
+    q->head = head + 1;
+
+    q->stats.posted++;
+    if (depth + 1 > q->stats.max_depth) {
+        q->stats.max_depth = depth + 1;
+    }
+
+    irq_restore(flags);
+    return true;
+}
+
+bool work_pending(void) {
+    struct work_queue* q = &queues[cpu_id()];
+    return q->head != q->tail;
+}
+
+// Run up to WORK_BATCH queued items; must be called with interrupts enabled
+// from the CPU's main loop. Returns the number of items run.
+uint32_t work_run(void) {
+    struct work_queue* q = &queues[cpu_id()];
+    uint32_t ran = 0;
+
+    while (ran < WORK_BATCH && q->tail != q->head) {
+        __asm__ volatile("" ::: "memory");
+        struct work_item item = q->items[q->tail % WORK_QUEUE_SIZE];
+        q->tail = q->tail + 1;
+
+        uint64_t start = rdtsc();
+        uint64_t latency = start - item.posted_tsc;
+        item.fn(item.arg);
+        uint64_t runtime = rdtsc() - start;
+
+        q->stats.executed++;
+        q->stats.total_latency += latency;
+        if (latency > q->stats.max_latency) {
+            q->stats.max_latency = latency;
+        }
+        if (runtime > q->stats.max_runtime) {
+            q->stats.max_runtime = runtime;
+        }
+        ran++;
+    }
+
+    return ran;
+}
+
+void work_get_stats(struct work_stats* stats) {
+    uint32_t flags = irq_save();
+    struct work_queue* q = &queues[cpu_id()];
+
+    *stats = q->stats;
+    stats->depth = q->head - q->tail;
+
+    irq_restore(flags);
+}
+
+void work_print_stats(void) {
+    struct work_stats stats;
+    work_get_stats(&stats);
+
+    uint64_t avg_latency = stats.executed ? div_u64_u32(stats.total_latency, stats.executed, 0) : 0;
+
+    terminal_writestring("posted:          ");
+    terminal_writedec(stats.posted);
+    terminal_writestring("\nexecuted:        ");
+    terminal_writedec(stats.executed);
+    terminal_writestring("\ndropped:         ");
+    terminal_writedec(stats.dropped);
+    terminal_writestring("\ndepth (max):     ");
+    terminal_writedec(stats.depth);
+    terminal_writestring(" (");
+    terminal_writedec(stats.max_depth);
+    terminal_writestring(")\nlatency avg/max: ");
+    terminal_writedec((uint32_t)tsc_to_us(avg_latency));
+    terminal_writestring("/");
+    terminal_writedec((uint32_t)tsc_to_us(stats.max_latency));
+    terminal_writestring(" us\nmax runtime:     ");
+    terminal_writedec((uint32_t)tsc_to_us(stats.max_runtime));
+    terminal_writestring(" us\n");
+}
@@ -0,0 +1,32 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Deferred work: interrupt handlers post small items that the main loop runs
+// later with interrupts enabled.
+typedef void (*work_fn_t)(uint32_t arg);
+
+#define WORK_QUEUE_SIZE 256   // Power of two
+#define WORK_BATCH      32    // Items run per work_run() call
+
+struct work_stats {
+    uint32_t posted;
+    uint32_t executed;
+    uint32_t dropped;         // Queue was full
+    uint32_t depth;
+    uint32_t max_depth;
+    uint64_t total_latency;   // TSC cycles from post to start
+    uint64_t max_latency;
+    uint64_t max_runtime;     // TSC cycles spent in a single item
+};
+
+// Work queue functions
+bool work_post(work_fn_t fn, uint32_t arg);
+bool work_pending(void);
+uint32_t work_run(void);
+void work_get_stats(struct work_stats* stats);
+void work_print_stats(void);
+
+#endif // WORKQUEUE_H
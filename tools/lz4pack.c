@@ -0,0 +1,228 @@
+// Host tool: flatten the kernel ELF into the memory image it occupies at its
+// load address and compress it as a single LZ4 block for the boot stub
+// (src/boot/stub.asm).
+//
+// Output layout, all fields little-endian:
+//   0   magic "LZ4K"
+//   4   load address of the image
+//   8   entry point
+//   12  unpacked size
+//   16  compressed size
+//   20  LZ4 block
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <elf.h>
+
+#define LZ4K_MAGIC 0x4B345A4C   // "LZ4K"
+
+// LZ4 block format limits: the last 5 bytes are always literals and the
+// last match starts at least 12 bytes before the end
+#define MIN_MATCH     4
+#define LAST_LITERALS 5
+#define MF_LIMIT      12
+#define MAX_OFFSET    65535
+
+#define HASH_BITS 16
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash32(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static size_t write_length(uint8_t* out, size_t length) {
+    size_t n = 0;
+    while (length >= 255) {
+        out[n++] = 255;
+        length -= 255;
+    }
+    out[n++] = (uint8_t)length;
+    return n;
+}
+
+// One sequence: literals followed by a match, or by nothing for the last one
+static size_t write_sequence(uint8_t* out, const uint8_t* literals, size_t literal_length,
+                             size_t offset, size_t match_length) {
+    size_t n = 0;
+    uint8_t* token = &out[n++];
+    size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+
+    *token = (uint8_t)((literal_length < 15 ? literal_length : 15) << 4);
+    if (literal_length >= 15) {
+        n += write_length(&out[n], literal_length - 15);
+    }
+    memcpy(&out[n], literals, literal_length);
+    n += literal_length;
+
+    if (match_length) {
+        *token |= (uint8_t)(match_code < 15 ? match_code : 15);
+        out[n++] = (uint8_t)(offset & 0xFF);
+        out[n++] = (uint8_t)(offset >> 8);
+        if (match_code >= 15) {
+            n += write_length(&out[n], match_code - 15);
+        }
+    }
+    return n;
+}
+
+// Greedy single-pass compressor; the output buffer must hold the worst case
+// of size + size / 255 + 16 bytes
+static size_t lz4_compress(const uint8_t* src, size_t size, uint8_t* dst) {
+    static uint32_t table[1 << HASH_BITS];  // Position + 1, 0 when empty
+    size_t anchor = 0;
+    size_t ip = 0;
+    size_t op = 0;
+
+    memset(table, 0, sizeof(table));
+
+    if (size > MF_LIMIT) {
+        size_t match_start_limit = size - MF_LIMIT;
+        size_t match_end_limit = size - LAST_LITERALS;
+
+        while (ip < match_start_limit) {
+            uint32_t sequence = read32(&src[ip]);
+            uint32_t h = hash32(sequence);
+            size_t candidate = table[h];
+            table[h] = (uint32_t)(ip + 1);
+
+            if (candidate == 0 || ip - (candidate - 1) > MAX_OFFSET ||
+                read32(&src[candidate - 1]) != sequence) {
+                ip++;
+                continue;
+            }
+
+            size_t ref = candidate - 1;
+            size_t length = MIN_MATCH;
+            while (ip + length < match_end_limit && src[ref + length] == src[ip + length]) {
+                length++;
+            }
+            while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+                ip--;
+                ref--;
+                length++;
+            }
+
+            op += write_sequence(&dst[op], &src[anchor], ip - anchor, ip - ref, length);
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    op += write_sequence(&dst[op], &src[anchor], size - anchor, 0, 0);
+    return op;
+}
+
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t* data = malloc(length > 0 ? (size_t)length : 1);
+    if (!data || fread(data, 1, (size_t)length, f) != (size_t)length) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(f);
+        free(data);
+        return NULL;
+    }
+
+    fclose(f);
+    *size = (size_t)length;
+    return data;
+}
+
+static void put32(uint8_t* p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s kernel.elf out.lz4\n", argv[0]);
+        return 1;
+    }
+
+    size_t elf_size;
+    uint8_t* elf = read_file(argv[1], &elf_size);
+    if (!elf) {
+        return 1;
+    }
+
+    const Elf32_Ehdr* ehdr = (const Elf32_Ehdr*)elf;
+    if (elf_size < sizeof(*ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr->e_ident[EI_CLASS] != ELFCLASS32 ||
+        ehdr->e_phoff + (size_t)ehdr->e_phnum * sizeof(Elf32_Phdr) > elf_size) {
+        fprintf(stderr, "%s: not a 32-bit ELF file\n", argv[1]);
+        return 1;
+    }
+    const Elf32_Phdr* phdr = (const Elf32_Phdr*)(elf + ehdr->e_phoff);
+
+    // The image spans every loadable segment with file contents; .bss is
+    // left out and cleared by the kernel itself
+    uint32_t start = UINT32_MAX;
+    uint32_t end = 0;
+    for (int i = 0; i < ehdr->e_phnum; i++) {
+        if (phdr[i].p_type != PT_LOAD || phdr[i].p_filesz == 0) {
+            continue;
+        }
+        if (phdr[i].p_offset + phdr[i].p_filesz > elf_size) {
+            fprintf(stderr, "%s: truncated segment\n", argv[1]);
+            return 1;
+        }
+        if (phdr[i].p_paddr < start) {
+            start = phdr[i].p_paddr;
+        }
+        if (phdr[i].p_paddr + phdr[i].p_filesz > end) {
+            end = phdr[i].p_paddr + phdr[i].p_filesz;
+        }
+    }
+    if (start >= end) {
+        fprintf(stderr, "%s: no loadable segments\n", argv[1]);
+        return 1;
+    }
+
+    size_t image_size = end - start;
+    uint8_t* image = calloc(1, image_size);
+    uint8_t* packed = malloc(20 + image_size + image_size / 255 + 16);
+    if (!image || !packed) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < ehdr->e_phnum; i++) {
+        if (phdr[i].p_type == PT_LOAD && phdr[i].p_filesz != 0) {
+            memcpy(&image[phdr[i].p_paddr - start], elf + phdr[i].p_offset, phdr[i].p_filesz);
+        }
+    }
+
+    size_t packed_size = lz4_compress(image, image_size, packed + 20);
+    put32(packed + 0, LZ4K_MAGIC);
+    put32(packed + 4, start);
+    put32(packed + 8, ehdr->e_entry);
+    put32(packed + 12, (uint32_t)image_size);
+    put32(packed + 16, (uint32_t)packed_size);
+
+    FILE* out = fopen(argv[2], "wb");
+    if (!out || fwrite(packed, 1, 20 + packed_size, out) != 20 + packed_size) {
+        perror(argv[2]);
+        return 1;
+    }
+    fclose(out);
+
+    printf("lz4pack: %zu -> %zu bytes (%zu%%)\n", image_size, packed_size,
+           packed_size * 100 / image_size);
+    return 0;
+}